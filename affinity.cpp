@@ -0,0 +1,85 @@
+#include "affinity.h"
+
+#include <algorithm>
+#include <map>
+
+bool parseAffinityPolicy(const std::string &name, AffinityPolicy &policy) {
+    if (name == "none")
+        policy = AffinityPolicy::None;
+    else if (name == "compact")
+        policy = AffinityPolicy::Compact;
+    else if (name == "scatter")
+        policy = AffinityPolicy::Scatter;
+    else if (name == "physical")
+        policy = AffinityPolicy::Physical;
+    else
+        return false;
+    return true;
+}
+
+/*
+ * Порядок "сначала разные ядра": первые SMT-"соседи" всех ядер,
+ * затем вторые и т.д. Внутри каждого "слоя" - сначала более
+ * производительные ядра, затем по возрастанию ядра.
+ * */
+static std::vector<LogicalProcessor> coresFirst(std::vector<LogicalProcessor> processors) {
+    std::map<int, int> siblingsSeen;
+    std::vector<std::pair<int, LogicalProcessor>> layered;
+    for (const LogicalProcessor &processor : processors)
+        layered.emplace_back(siblingsSeen[processor.core]++, processor);
+
+    std::stable_sort(layered.begin(), layered.end(), [](const auto &a, const auto &b) {
+        if (a.first != b.first)
+            return a.first < b.first;
+        if (a.second.efficiencyClass != b.second.efficiencyClass)
+            return a.second.efficiencyClass > b.second.efficiencyClass;
+        return a.second.core < b.second.core;
+    });
+
+    processors.clear();
+    for (const auto &entry : layered)
+        processors.push_back(entry.second);
+    return processors;
+}
+
+std::vector<LogicalProcessor> placeWorkers(AffinityPolicy policy,
+                                           const std::vector<LogicalProcessor> &topology,
+                                           int numberOfThreads) {
+    if (policy == AffinityPolicy::None || topology.empty())
+        return {};
+
+    std::vector<LogicalProcessor> order = topology;
+    std::stable_sort(order.begin(), order.end(), [](const LogicalProcessor &a, const LogicalProcessor &b) {
+        if (a.node != b.node)
+            return a.node < b.node;
+        // На гибридных процессорах потоки сначала занимают P-ядра
+        if (a.efficiencyClass != b.efficiencyClass)
+            return a.efficiencyClass > b.efficiencyClass;
+        return a.core < b.core;
+    });
+
+    if (policy == AffinityPolicy::Physical) {
+        order = coresFirst(order);
+    } else if (policy == AffinityPolicy::Scatter) {
+        // Процессоры каждого узла в порядке "сначала разные ядра"
+        std::map<int, std::vector<LogicalProcessor>> nodes;
+        for (const LogicalProcessor &processor : order)
+            nodes[processor.node].push_back(processor);
+        for (auto &node : nodes)
+            node.second = coresFirst(node.second);
+
+        // Берем по одному процессору из каждого узла по кругу
+        order.clear();
+        for (size_t position = 0; order.size() < topology.size(); position++) {
+            for (auto &node : nodes) {
+                if (position < node.second.size())
+                    order.push_back(node.second[position]);
+            }
+        }
+    }
+
+    std::vector<LogicalProcessor> placement;
+    for (int i = 0; i < numberOfThreads; i++)
+        placement.push_back(order[i % order.size()]);
+    return placement;
+}
@@ -0,0 +1,40 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <string>
+#include <vector>
+
+#include "backend.h"
+
+/*
+ * Политика размещения потоков по логическим процессорам:
+ *      None - потоки не привязываются, размещением управляет ОС;
+ *      Compact - потоки занимают процессоры подряд: сначала все SMT-"соседи"
+ *      одного ядра, затем следующее ядро того же NUMA-узла;
+ *      Scatter - потоки распределяются по NUMA-узлам по кругу,
+ *      внутри узла - сначала по разным физическим ядрам;
+ *      Physical - по одному потоку на физическое ядро, SMT-"соседи"
+ *      используются только если потоков больше, чем ядер.
+ * На гибридных процессорах внутри NUMA-узла во всех политиках сначала
+ * занимаются более производительные ядра (см. LogicalProcessor::efficiencyClass).
+ * */
+enum class AffinityPolicy {
+    None,
+    Compact,
+    Scatter,
+    Physical
+};
+
+// Разбор названия политики (none, compact, scatter, physical).
+bool parseAffinityPolicy(const std::string &name, AffinityPolicy &policy);
+
+/*
+ * Процессоры для потоков 0..numberOfThreads-1 согласно политике.
+ * Если потоков больше, чем процессоров, порядок повторяется по кругу.
+ * Для политики None возвращается пустой список.
+ * */
+std::vector<LogicalProcessor> placeWorkers(AffinityPolicy policy,
+                                           const std::vector<LogicalProcessor> &topology,
+                                           int numberOfThreads);
+
+#endif //AFFINITY_H
@@ -0,0 +1,119 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+
+/*
+ * Бэкенд потоков - создание, запуск, приостановка
+ * и ожидание потоков-исполнителей.
+ * Реализация выбирается при сборке (THREADING_BACKEND в CMakeLists.txt):
+ *      backend_win32.cpp - Win32 API (CreateThread, WaitOnAddress,
+ *      порт завершения);
+ *      backend_std.cpp - std::thread, семафоры и std::atomic::wait C++20.
+ * */
+
+#include <cstddef>
+#include <vector>
+
+// Функция, которую выполняет поток; получает данные задания и номер потока в задании.
+typedef void (*WorkerFunction)(void *job, int threadIndex);
+
+// Название бэкенда для вывода
+const char *backendName();
+
+// Число логических процессоров в системе
+int numberOfProcessors();
+
+// Логический процессор и его место в топологии системы
+struct LogicalProcessor {
+    // Группа процессоров (Windows, > 64 логических процессоров), 0 на других ОС
+    int group;
+    // Номер процессора в группе
+    int number;
+    // Сквозной номер физического ядра (у SMT-"соседей" он одинаковый)
+    int core;
+    // NUMA-узел
+    int node;
+    /*
+     * Класс эффективности ядра: чем больше, тем ядро производительнее
+     * (P-ядра гибридных процессоров выше E-ядер); 0, если все ядра одинаковы.
+     * */
+    int efficiencyClass = 0;
+};
+
+// Список логических процессоров, доступных процессу.
+std::vector<LogicalProcessor> processorTopology();
+
+/*
+ * Потоки образуют пул, который переживает отдельные расчеты:
+ * createWorkers занимает свободные потоки пула (и досоздает недостающие)
+ * под новое задание, joinWorkers ждет окончания задания и освобождает их.
+ * Потоки задания образуют группу WorkerGroup с номерами 0..numberOfThreads-1,
+ * и несколько заданий могут одновременно выполняться на разных группах.
+ * Функции группы вызывает поток, создавший ее (главный поток задания),
+ * а notifyBlockDone - потоки самой группы.
+ * Если сохранение потоков выключено, joinWorkers
+ * завершает потоки группы, и каждый расчет создает их заново.
+ * */
+void setPersistentWorkers(bool persistent);
+
+struct WorkerGroup;
+
+/*
+ * Подготовка numberOfThreads потоков к выполнению function(job, номер потока).
+ * Потоки не начинают работу до вызова startWorkers.
+ * */
+WorkerGroup *createWorkers(int numberOfThreads, WorkerFunction function, void *job);
+
+/*
+ * Привязка созданного (еще не запущенного) потока к логическому процессору.
+ * Возвращает false, если привязка не удалась или не поддерживается.
+ * Привязка действует только в текущем задании: поток, привязанный раньше
+ * и не привязанный заново, startWorkers возвращает к исходной маске процессоров.
+ * */
+bool pinWorker(WorkerGroup *group, int threadIndex, const LogicalProcessor &processor);
+
+// Запуск созданных потоков.
+void startWorkers(WorkerGroup *group);
+
+/*
+ * Приоритет вызывающего потока: idle = true - наименьший (SCHED_IDLE в Linux,
+ * THREAD_PRIORITY_IDLE в Win32), поток получает процессор, только когда
+ * он не нужен другим потокам; false - обычный приоритет.
+ * Вызывается самим потоком пула в начале задания; возвращает false,
+ * если приоритет изменить не удалось или это не поддерживается.
+ * */
+bool setCurrentThreadIdlePriority(bool idle);
+
+/*
+ * Вызывается потоком по окончании расчета блока в режиме Handshake:
+ * сообщает главному потоку номер потока и, если park = true,
+ * приостанавливает поток до вызова resumeWorker.
+ * Поток ждет сам (WaitOnAddress/futex), а не приостанавливается
+ * извне, поэтому resumeWorker, вызванный до приостановки, не теряется:
+ * поток сразу продолжит работу.
+ * */
+void notifyBlockDone(WorkerGroup *group, int threadIndex, bool park);
+
+/*
+ * Вызывается главным потоком: ждет сообщения notifyBlockDone
+ * и возвращает номер сообщившего потока.
+ * */
+int waitForBlockDone(WorkerGroup *group);
+
+// Возобновление приостановленного потока.
+void resumeWorker(WorkerGroup *group, int threadIndex);
+
+// Ожидание окончания задания всеми потоками; потоки возвращаются в пул, group удаляется.
+void joinWorkers(WorkerGroup *group);
+
+// Завершение всех потоков пула; вызывается, когда ни одно задание не выполняется.
+void shutdownWorkers();
+
+/*
+ * Выделение памяти для данных потока на NUMA-узле,
+ * на котором поток выполняется. Вызывается самим потоком
+ * (после привязки к процессору), память выравнивается по странице.
+ * */
+void *allocateLocal(size_t size);
+void freeLocal(void *memory, size_t size);
+
+#endif //BACKEND_H
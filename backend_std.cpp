@@ -0,0 +1,396 @@
+#include "backend.h"
+
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <semaphore>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <vector>
+#include <memory>
+#include <new>
+
+#include "cacheline.h"
+
+#ifdef __linux__
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <filesystem>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+/*
+ * Потоки пула живут между расчетами: закончив задание,
+ * поток ждет следующего на своем семафоре startSignal.
+ * createWorkers занимает свободные потоки пула (busy = false)
+ * и досоздает недостающие, поэтому пул растет до наибольшего числа
+ * потоков, одновременно занятых заданиями.
+ * */
+struct PoolThread {
+    std::thread thread;
+    std::counting_semaphore<> startSignal{0};
+    // Задание потока и его номер в задании; задаются до startSignal
+    WorkerGroup *group = nullptr;
+    int threadIndex = 0;
+    bool busy = false;
+    // Поток завершается, получив startSignal при exiting = true
+    bool exiting = false;
+#ifdef __linux__
+    /*
+     * Исходная маска потока (до первой привязки) и признаки привязки:
+     * pinned - поток привязан к процессору, pinnedForJob - привязан в текущем задании.
+     * Поток, привязанный в прошлом задании и не привязанный в текущем,
+     * startWorkers возвращает к исходной маске.
+     * */
+    cpu_set_t originalMask;
+#endif
+    bool pinned = false;
+    bool pinnedForJob = false;
+};
+
+/*
+ * Потоки пула по указателям: указатель на поток хранится в его группе
+ * и не меняется, когда вектор расширяется другим заданием.
+ * Вектор и признаки busy защищены poolMutex.
+ * */
+static std::vector<std::unique_ptr<PoolThread>> workers;
+static std::mutex poolMutex;
+static bool persistentWorkers = true;
+
+/*
+ * Приостановка потока в режиме Handshake.
+ * У каждого потока свое "разрешение" permit: resumeWorker выставляет
+ * его и будит поток (std::atomic::notify_one, на Linux - futex),
+ * поток ждет, пока разрешение не появится (std::atomic::wait), и забирает его.
+ * Разрешение, выданное раньше, чем поток успел приостановиться, не теряется.
+ * Каждое разрешение на своей кэш-линии.
+ * */
+struct alignas(CACHE_LINE_SIZE) ParkingSpot {
+    std::atomic<int> permit{0};
+};
+
+/*
+ * Группа потоков одного задания: разрешения потоков, очередь номеров
+ * потоков, закончивших блок (аналог порта завершения Win32),
+ * и число потоков, еще не закончивших задание.
+ * Конец задания отсчитывается под doneMutex, а не std::latch:
+ * joinWorkers удаляет группу сразу после ожидания, и последний поток
+ * не должен обращаться к ней после того, как главный поток проснулся.
+ * */
+struct WorkerGroup {
+    WorkerFunction function;
+    void *job;
+    std::vector<PoolThread *> threads;
+    std::unique_ptr<ParkingSpot[]> parking;
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    std::queue<int> doneQueue;
+    int remainingWorkers;
+};
+
+const char *backendName() {
+    return "std::thread";
+}
+
+int numberOfProcessors() {
+    unsigned int processors = std::thread::hardware_concurrency();
+    return processors ? (int) processors : 1;
+}
+
+#ifdef __linux__
+// Чтение числа из файла sysfs; -1, если файла нет.
+static int readSysfsNumber(const std::string &path) {
+    std::ifstream file(path);
+    int value = -1;
+    file >> value;
+    return value;
+}
+
+// Список процессоров вида "0-7,16,18-19" из файла sysfs; пустой, если файла нет.
+static std::set<int> readSysfsCpuList(const std::string &path) {
+    std::ifstream file(path);
+    std::set<int> cpus;
+    std::string range;
+    while (std::getline(file, range, ',')) {
+        std::istringstream stream(range);
+        int first, last;
+        char dash;
+        if (!(stream >> first))
+            continue;
+        last = first;
+        if (stream >> dash)
+            stream >> last;
+        for (int cpu = first; cpu <= last; cpu++)
+            cpus.insert(cpu);
+    }
+    return cpus;
+}
+
+/*
+ * Класс эффективности процессоров.
+ * Гибридные процессоры Intel регистрируют E-ядра отдельным PMU cpu_atom
+ * (/sys/devices/cpu_atom/cpus): они получают класс 0, остальные - 1.
+ * Иначе (ARM big.LITTLE) классом служит номер значения cpu_capacity
+ * среди различных значений по возрастанию.
+ * */
+static void assignEfficiencyClasses(std::vector<LogicalProcessor> &processors) {
+    std::set<int> atoms = readSysfsCpuList("/sys/devices/cpu_atom/cpus");
+    if (!atoms.empty()) {
+        for (LogicalProcessor &processor : processors)
+            processor.efficiencyClass = atoms.count(processor.number) ? 0 : 1;
+        return;
+    }
+
+    std::vector<int> capacities;
+    std::set<int> distinct;
+    for (const LogicalProcessor &processor : processors) {
+        int capacity = readSysfsNumber("/sys/devices/system/cpu/cpu" + std::to_string(processor.number)
+                                       + "/cpu_capacity");
+        capacities.push_back(capacity);
+        distinct.insert(capacity);
+    }
+    for (size_t i = 0; i < processors.size(); i++)
+        processors[i].efficiencyClass = (int) std::distance(distinct.begin(), distinct.find(capacities[i]));
+}
+
+/*
+ * Топология строится по /sys/devices/system/cpu:
+ * физическое ядро определяется парой (physical_package_id, core_id),
+ * NUMA-узел - по каталогу nodeN в каталоге процессора,
+ * класс эффективности - см. assignEfficiencyClasses.
+ * Учитываются только процессоры из маски процесса (sched_getaffinity).
+ * */
+std::vector<LogicalProcessor> processorTopology() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    std::vector<LogicalProcessor> processors;
+    std::map<std::pair<int, int>, int> cores;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed))
+            continue;
+        std::string directory = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+        int package = readSysfsNumber(directory + "/topology/physical_package_id");
+        int coreId = readSysfsNumber(directory + "/topology/core_id");
+        auto key = coreId < 0 ? std::make_pair(-1, cpu) : std::make_pair(package, coreId);
+        auto core = cores.emplace(key, (int) cores.size()).first->second;
+
+        int node = 0;
+        std::error_code error;
+        for (const auto &entry : std::filesystem::directory_iterator(directory, error)) {
+            std::string name = entry.path().filename().string();
+            if (name.rfind("node", 0) == 0 && name.size() > 4 && isdigit((unsigned char) name[4]))
+                node = std::stoi(name.substr(4));
+        }
+        processors.push_back({0, cpu, core, node});
+    }
+    assignEfficiencyClasses(processors);
+    return processors;
+}
+
+bool pinWorker(WorkerGroup *group, int threadIndex, const LogicalProcessor &processor) {
+    PoolThread &worker = *group->threads[threadIndex];
+    pthread_t thread = worker.thread.native_handle();
+    if (!worker.pinned && pthread_getaffinity_np(thread, sizeof(cpu_set_t), &worker.originalMask) != 0)
+        return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(processor.number, &set);
+    if (pthread_setaffinity_np(thread, sizeof(set), &set) != 0)
+        return false;
+    worker.pinned = worker.pinnedForJob = true;
+    return true;
+}
+
+static void restoreAffinity(PoolThread &worker) {
+    if (worker.pinned && !worker.pinnedForJob
+        && pthread_setaffinity_np(worker.thread.native_handle(), sizeof(cpu_set_t), &worker.originalMask) == 0)
+        worker.pinned = false;
+}
+
+/*
+ * Возврат из SCHED_IDLE в SCHED_OTHER разрешен и без прав (Linux 2.6.39+),
+ * если nice потока в пределах RLIMIT_NICE.
+ * Текущая политика запоминается, чтобы не делать системный вызов в каждом задании.
+ * */
+bool setCurrentThreadIdlePriority(bool idle) {
+    static thread_local bool currentIdle = false;
+    if (idle == currentIdle)
+        return true;
+    sched_param parameters = {};
+    if (pthread_setschedparam(pthread_self(), idle ? SCHED_IDLE : SCHED_OTHER, &parameters) != 0)
+        return false;
+    currentIdle = idle;
+    return true;
+}
+
+/*
+ * Анонимная память через mmap размещается ядром Linux на узле того потока,
+ * который первым к ней обратился (first touch), а allocateLocal
+ * вызывается самим потоком-исполнителем.
+ * */
+void *allocateLocal(size_t size) {
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return memory == MAP_FAILED ? nullptr : memory;
+}
+
+void freeLocal(void *memory, size_t size) {
+    munmap(memory, size);
+}
+#else
+// Без сведений о топологии считаем каждый процессор отдельным ядром.
+std::vector<LogicalProcessor> processorTopology() {
+    std::vector<LogicalProcessor> processors;
+    for (int cpu = 0; cpu < numberOfProcessors(); cpu++)
+        processors.push_back({0, cpu, cpu, 0});
+    return processors;
+}
+
+bool pinWorker(WorkerGroup *, int, const LogicalProcessor &) {
+    return false;
+}
+
+static void restoreAffinity(PoolThread &) {
+}
+
+bool setCurrentThreadIdlePriority(bool idle) {
+    return !idle;
+}
+
+void *allocateLocal(size_t size) {
+    return ::operator new(size, std::align_val_t(4096), std::nothrow);
+}
+
+void freeLocal(void *memory, size_t) {
+    ::operator delete(memory, std::align_val_t(4096));
+}
+#endif
+
+void setPersistentWorkers(bool persistent) {
+    persistentWorkers = persistent;
+}
+
+/*
+ * Цикл потока пула: ждет задания на своем семафоре запуска,
+ * выполняет функцию задания и отсчитывает remainingWorkers группы.
+ * Поток получает указатель на свою запись, а не индекс в workers,
+ * т.к. другие задания могут расширять вектор, пока поток ждет задания.
+ * */
+static void poolThread(PoolThread *self) {
+    while (true) {
+        self->startSignal.acquire();
+        if (self->exiting)
+            return;
+        WorkerGroup *group = self->group;
+        group->function(group->job, self->threadIndex);
+
+        std::lock_guard<std::mutex> lock(group->doneMutex);
+        if (--group->remainingWorkers == 0)
+            group->doneCondition.notify_one();
+    }
+}
+
+WorkerGroup *createWorkers(int numberOfThreads, WorkerFunction function, void *job) {
+    auto *group = new WorkerGroup;
+    group->function = function;
+    group->job = job;
+    group->parking = std::make_unique<ParkingSpot[]>(numberOfThreads);
+    group->remainingWorkers = numberOfThreads;
+
+    // Занимаем свободные потоки пула, недостающие досоздаем.
+    std::lock_guard<std::mutex> lock(poolMutex);
+    for (size_t i = 0; i < workers.size() && (int) group->threads.size() < numberOfThreads; i++) {
+        if (!workers[i]->busy)
+            group->threads.push_back(workers[i].get());
+    }
+    while ((int) group->threads.size() < numberOfThreads) {
+        workers.push_back(std::make_unique<PoolThread>());
+        PoolThread *worker = workers.back().get();
+        worker->thread = std::thread(poolThread, worker);
+        group->threads.push_back(worker);
+    }
+    for (int i = 0; i < numberOfThreads; i++) {
+        PoolThread *worker = group->threads[i];
+        worker->busy = true;
+        worker->group = group;
+        worker->threadIndex = i;
+        worker->pinnedForJob = false;
+    }
+    return group;
+}
+
+void startWorkers(WorkerGroup *group) {
+    for (PoolThread *worker : group->threads) {
+        restoreAffinity(*worker);
+        worker->startSignal.release();
+    }
+}
+
+void notifyBlockDone(WorkerGroup *group, int threadIndex, bool park) {
+    {
+        std::lock_guard<std::mutex> lock(group->doneMutex);
+        group->doneQueue.push(threadIndex);
+    }
+    group->doneCondition.notify_one();
+
+    if (park) {
+        std::atomic<int> &permit = group->parking[threadIndex].permit;
+        while (permit.exchange(0, std::memory_order_acquire) == 0)
+            permit.wait(0, std::memory_order_relaxed);
+    }
+}
+
+int waitForBlockDone(WorkerGroup *group) {
+    std::unique_lock<std::mutex> lock(group->doneMutex);
+    group->doneCondition.wait(lock, [group] { return !group->doneQueue.empty(); });
+    int threadIndex = group->doneQueue.front();
+    group->doneQueue.pop();
+    return threadIndex;
+}
+
+void resumeWorker(WorkerGroup *group, int threadIndex) {
+    std::atomic<int> &permit = group->parking[threadIndex].permit;
+    permit.store(1, std::memory_order_release);
+    permit.notify_one();
+}
+
+// Завершение потоков из списка и удаление их из пула (вызывается под poolMutex)
+static void retireWorkers(const std::vector<PoolThread *> &retired) {
+    for (PoolThread *worker : retired) {
+        worker->exiting = true;
+        worker->startSignal.release();
+        worker->thread.join();
+    }
+    std::erase_if(workers, [&retired](const std::unique_ptr<PoolThread> &worker) {
+        return std::find(retired.begin(), retired.end(), worker.get()) != retired.end();
+    });
+}
+
+void joinWorkers(WorkerGroup *group) {
+    {
+        std::unique_lock<std::mutex> lock(group->doneMutex);
+        group->doneCondition.wait(lock, [group] { return group->remainingWorkers == 0; });
+    }
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+    for (PoolThread *worker : group->threads)
+        worker->busy = false;
+    if (!persistentWorkers)
+        retireWorkers(group->threads);
+    delete group;
+}
+
+void shutdownWorkers() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    std::vector<PoolThread *> all;
+    for (const std::unique_ptr<PoolThread> &worker : workers)
+        all.push_back(worker.get());
+    retireWorkers(all);
+}
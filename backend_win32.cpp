@@ -0,0 +1,362 @@
+#include "backend.h"
+
+#include <iostream>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <windows.h>
+
+#include "cacheline.h"
+
+/*
+ * Потоки пула живут между расчетами: после задания поток
+ * ждет своего события startEvent, а не завершается.
+ * createWorkers занимает свободные потоки пула (busy = false)
+ * и досоздает недостающие, поэтому пул растет до наибольшего числа
+ * потоков, одновременно занятых заданиями.
+ * */
+struct PoolThread {
+    HANDLE thread = nullptr;
+    // Событие запуска задания (с автосбросом)
+    HANDLE startEvent = nullptr;
+    // Задание потока и его номер в задании; задаются до startEvent
+    WorkerGroup *group = nullptr;
+    int threadIndex = 0;
+    bool busy = false;
+    // Поток завершается, получив startEvent при exiting = true
+    volatile bool exiting = false;
+    /*
+     * Исходная маска потока (до первой привязки) и признаки привязки:
+     * pinned - поток привязан к процессору, pinnedForJob - привязан в текущем задании.
+     * Поток, привязанный в прошлом задании и не привязанный в текущем,
+     * startWorkers возвращает к исходной маске.
+     * */
+    GROUP_AFFINITY originalAffinity = {};
+    bool pinned = false;
+    bool pinnedForJob = false;
+};
+
+/*
+ * Потоки пула по указателям: указатель на поток хранится в его группе
+ * и не меняется, когда вектор расширяется другим заданием.
+ * Вектор и признаки busy защищены poolMutex.
+ * */
+static std::vector<std::unique_ptr<PoolThread>> threadsArray;
+static std::mutex poolMutex;
+// Сохранять ли потоки после задания (см. setPersistentWorkers)
+static bool persistentWorkers = true;
+
+/*
+ * Приостановка потока в режиме Handshake.
+ * Раньше поток вызывал SuspendThread сам для себя, и если ResumeThread
+ * главного потока успевал раньше, возобновление терялось: поток
+ * стоял до общего возобновления в конце расчета.
+ * Теперь у каждого потока есть "разрешение" permit: resumeWorker
+ * выставляет его и будит поток (WakeByAddressSingle), а поток ждет,
+ * пока разрешение не появится (WaitOnAddress), и забирает его.
+ * Разрешение, выданное до того, как поток стал ждать, не теряется.
+ * Каждое разрешение на своей кэш-линии.
+ * */
+struct alignas(CACHE_LINE_SIZE) ParkingSpot {
+    volatile LONG permit;
+};
+
+/*
+ * Группа потоков одного задания.
+ * Порт завершения completionPort, через который потоки в режиме Handshake
+ * сообщают главному потоку об окончании расчета блока.
+ * В отличие от массива событий и WaitForMultipleObjects
+ * (не более MAXIMUM_WAIT_OBJECTS = 64 объектов) порт не ограничивает
+ * число потоков: поток кладет в очередь порта свой номер,
+ * главный поток забирает номера по одному.
+ * Событие jobDoneEvent сигналит последний закончивший задание поток
+ * (remainingWorkers - число потоков, еще не закончивших задание).
+ * */
+struct WorkerGroup {
+    WorkerFunction function;
+    void *job;
+    std::vector<PoolThread *> threads;
+    std::vector<ParkingSpot> parking;
+    HANDLE completionPort;
+    HANDLE jobDoneEvent;
+    volatile LONG remainingWorkers;
+};
+
+const char *backendName() {
+    return "Win32";
+}
+
+/*
+ * Топология строится по GetLogicalProcessorInformationEx:
+ * записи RelationProcessorCore перечисляют физические ядра
+ * с масками их логических процессоров (по группам) и классом
+ * эффективности ядра (EfficiencyClass, Windows 10 и новее; на
+ * гибридных процессорах у P-ядер он больше, иначе 0 у всех ядер),
+ * записи RelationNumaNode - маски процессоров NUMA-узлов.
+ * */
+std::vector<LogicalProcessor> processorTopology() {
+    DWORD length = 0;
+    GetLogicalProcessorInformationEx(RelationAll, nullptr, &length);
+    std::vector<char> buffer(length);
+    auto *information = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX) buffer.data();
+    if (!GetLogicalProcessorInformationEx(RelationAll, information, &length))
+        return {};
+
+    std::vector<LogicalProcessor> processors;
+    int core = 0;
+    for (DWORD offset = 0; offset < length; offset += information->Size) {
+        information = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX) (buffer.data() + offset);
+        if (information->Relationship != RelationProcessorCore)
+            continue;
+        for (WORD g = 0; g < information->Processor.GroupCount; g++) {
+            const GROUP_AFFINITY &affinity = information->Processor.GroupMask[g];
+            for (int bit = 0; bit < (int) sizeof(KAFFINITY) * 8; bit++) {
+                if (affinity.Mask & ((KAFFINITY) 1 << bit))
+                    processors.push_back({affinity.Group, bit, core, 0, information->Processor.EfficiencyClass});
+            }
+        }
+        core++;
+    }
+
+    for (DWORD offset = 0; offset < length; offset += information->Size) {
+        information = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX) (buffer.data() + offset);
+        if (information->Relationship != RelationNumaNode)
+            continue;
+        const GROUP_AFFINITY &affinity = information->NumaNode.GroupMask;
+        for (LogicalProcessor &processor : processors) {
+            if (processor.group == affinity.Group && (affinity.Mask & ((KAFFINITY) 1 << processor.number)))
+                processor.node = (int) information->NumaNode.NodeNumber;
+        }
+    }
+    return processors;
+}
+
+int numberOfProcessors() {
+    // Число логических процессоров во всех группах процессоров.
+    return (int) GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+}
+
+/*
+ * Точка входа потока Win32: ждет задания и передает номер потока
+ * в функцию задания; последний закончивший поток сигналит jobDoneEvent группы.
+ * Поток получает указатель на свою запись, а не индекс в threadsArray,
+ * т.к. другие задания могут расширять вектор, пока поток ждет задания.
+ * */
+static DWORD WINAPI threadProc(CONST LPVOID parameter) {
+    auto *self = (PoolThread *) parameter;
+    while (true) {
+        WaitForSingleObject(self->startEvent, INFINITE);
+        if (self->exiting)
+            return 0;
+
+        WorkerGroup *group = self->group;
+        group->function(group->job, self->threadIndex);
+
+        // После последнего уменьшения группа может быть удалена в joinWorkers
+        HANDLE jobDoneEvent = group->jobDoneEvent;
+        if (InterlockedDecrement(&group->remainingWorkers) == 0)
+            SetEvent(jobDoneEvent);
+    }
+}
+
+void setPersistentWorkers(bool persistent) {
+    persistentWorkers = persistent;
+}
+
+WorkerGroup *createWorkers(int numberOfThreads, WorkerFunction function, void *job) {
+    auto *group = new WorkerGroup;
+    group->function = function;
+    group->job = job;
+    group->remainingWorkers = numberOfThreads;
+    group->jobDoneEvent = CreateEventA(nullptr, false, false, nullptr);
+    group->completionPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 0);
+    group->parking.resize(numberOfThreads);
+    for (ParkingSpot &spot : group->parking)
+        spot.permit = 0;
+
+    /*
+     * Занимаем свободные потоки пула и досоздаем недостающие.
+     * При этом в каждый поток передается указатель на его запись.
+     * До события запуска поток ничего не делает.
+     * */
+    std::unique_lock<std::mutex> lock(poolMutex);
+    for (size_t i = 0; i < threadsArray.size() && (int) group->threads.size() < numberOfThreads; i++) {
+        if (!threadsArray[i]->busy)
+            group->threads.push_back(threadsArray[i].get());
+    }
+    while ((int) group->threads.size() < numberOfThreads) {
+        threadsArray.push_back(std::make_unique<PoolThread>());
+        PoolThread *worker = threadsArray.back().get();
+        worker->startEvent = CreateEventA(nullptr, false, false, nullptr);
+        worker->thread = CreateThread(nullptr, 0, threadProc, worker, 0, nullptr);
+        if (!worker->thread)
+            std::cout << "Could not create thread #" << threadsArray.size() - 1 << ". Error " << GetLastError()
+                      << std::endl;
+        group->threads.push_back(worker);
+    }
+    for (int i = 0; i < numberOfThreads; i++) {
+        PoolThread *worker = group->threads[i];
+        worker->busy = true;
+        worker->group = group;
+        worker->threadIndex = i;
+        worker->pinnedForJob = false;
+    }
+    lock.unlock();
+    return group;
+}
+
+/*
+ * SetThreadGroupAffinity задает и группу процессоров,
+ * поэтому потоки можно разместить на всех процессорах
+ * системы, а не только в группе главного потока.
+ * */
+bool pinWorker(WorkerGroup *group, int threadIndex, const LogicalProcessor &processor) {
+    PoolThread &worker = *group->threads[threadIndex];
+    GROUP_AFFINITY affinity = {};
+    affinity.Group = (WORD) processor.group;
+    affinity.Mask = (KAFFINITY) 1 << processor.number;
+    GROUP_AFFINITY previous = {};
+    if (!SetThreadGroupAffinity(worker.thread, &affinity, &previous))
+        return false;
+    if (!worker.pinned)
+        worker.originalAffinity = previous;
+    worker.pinned = worker.pinnedForJob = true;
+    return true;
+}
+
+static void restoreAffinity(PoolThread &worker) {
+    if (worker.pinned && !worker.pinnedForJob
+        && SetThreadGroupAffinity(worker.thread, &worker.originalAffinity, nullptr))
+        worker.pinned = false;
+}
+
+// Текущий приоритет запоминается, чтобы не менять его в каждом задании
+bool setCurrentThreadIdlePriority(bool idle) {
+    static thread_local bool currentIdle = false;
+    if (idle == currentIdle)
+        return true;
+    if (!SetThreadPriority(GetCurrentThread(), idle ? THREAD_PRIORITY_IDLE : THREAD_PRIORITY_NORMAL))
+        return false;
+    currentIdle = idle;
+    return true;
+}
+
+void startWorkers(WorkerGroup *group) {
+    // Запускаем задание на потоках.
+    for (PoolThread *worker : group->threads) {
+        restoreAffinity(*worker);
+        SetEvent(worker->startEvent);
+    }
+}
+
+void notifyBlockDone(WorkerGroup *group, int threadIndex, bool park) {
+    /*
+     * Кладем номер потока в очередь порта завершения,
+     * сигнализируя об окончания расчета очередного блока.
+     * */
+    PostQueuedCompletionStatus(group->completionPort, 0, (ULONG_PTR) threadIndex, nullptr);
+
+    /*
+     * Если это был не последний блок, ждем разрешения продолжить.
+     * WaitOnAddress возвращается, когда значение отличается от нуля
+     * (или при ложном пробуждении), поэтому разрешение проверяется в цикле.
+     * */
+    if (park) {
+        volatile LONG *permit = &group->parking[threadIndex].permit;
+        LONG empty = 0;
+        while (InterlockedCompareExchange(permit, 0, 1) != 1)
+            WaitOnAddress(permit, &empty, sizeof(LONG), INFINITE);
+    }
+}
+
+int waitForBlockDone(WorkerGroup *group) {
+    /*
+     * Ждем первого сообщения в порте завершения.
+     * Т.е. поток по окончании расчета очередного блока положит в порт
+     * свой номер и приостановится.
+     * */
+    DWORD bytesTransferred;
+    ULONG_PTR suspendedThreadIndex;
+    LPOVERLAPPED overlapped;
+    GetQueuedCompletionStatus(group->completionPort, &bytesTransferred, &suspendedThreadIndex, &overlapped,
+                              INFINITE);
+    return (int) suspendedThreadIndex;
+}
+
+void resumeWorker(WorkerGroup *group, int threadIndex) {
+    ParkingSpot &spot = group->parking[threadIndex];
+    InterlockedExchange(&spot.permit, 1);
+    WakeByAddressSingle((PVOID) &spot.permit);
+}
+
+/*
+ * Завершение потоков из списка и удаление их из пула (вызывается под poolMutex).
+ * WaitForMultipleObjects принимает не более MAXIMUM_WAIT_OBJECTS
+ * HANDLE'ов, поэтому потоки ждем группами по MAXIMUM_WAIT_OBJECTS.
+ * */
+static void retireWorkers(const std::vector<PoolThread *> &retired) {
+    std::vector<HANDLE> handles;
+    for (PoolThread *worker : retired) {
+        worker->exiting = true;
+        SetEvent(worker->startEvent);
+        if (worker->thread)
+            handles.push_back(worker->thread);
+    }
+    int count = (int) handles.size();
+    for (int first = 0; first < count; first += MAXIMUM_WAIT_OBJECTS) {
+        DWORD part = std::min(count - first, MAXIMUM_WAIT_OBJECTS);
+        WaitForMultipleObjects(part, handles.data() + first, true, INFINITE);
+    }
+
+    // Закрываем HANDLE'ы потоков и событий.
+    for (PoolThread *worker : retired) {
+        if (worker->thread)
+            CloseHandle(worker->thread);
+        CloseHandle(worker->startEvent);
+    }
+    std::erase_if(threadsArray, [&retired](const std::unique_ptr<PoolThread> &worker) {
+        return std::find(retired.begin(), retired.end(), worker.get()) != retired.end();
+    });
+}
+
+void joinWorkers(WorkerGroup *group) {
+    /*
+     * Ждем пока все потоки не закончат задание.
+     * Счетчик remainingWorkers вместо ожидания HANDLE'ов потоков
+     * не зависит от ограничения MAXIMUM_WAIT_OBJECTS.
+     * */
+    WaitForSingleObject(group->jobDoneEvent, INFINITE);
+
+    std::unique_lock<std::mutex> lock(poolMutex);
+    for (PoolThread *worker : group->threads)
+        worker->busy = false;
+    if (!persistentWorkers)
+        retireWorkers(group->threads);
+    lock.unlock();
+
+    CloseHandle(group->jobDoneEvent);
+    CloseHandle(group->completionPort);
+    delete group;
+}
+
+void shutdownWorkers() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    std::vector<PoolThread *> all;
+    for (const std::unique_ptr<PoolThread> &worker : threadsArray)
+        all.push_back(worker.get());
+    retireWorkers(all);
+}
+
+void *allocateLocal(size_t size) {
+    PROCESSOR_NUMBER processor;
+    GetCurrentProcessorNumberEx(&processor);
+    USHORT node;
+    DWORD preferredNode = GetNumaProcessorNodeEx(&processor, &node) ? node : NUMA_NO_PREFERRED_NODE;
+    return VirtualAllocExNuma(GetCurrentProcess(), nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE,
+                              preferredNode);
+}
+
+void freeLocal(void *memory, size_t) {
+    VirtualFree(memory, 0, MEM_RELEASE);
+}
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "backend.h"
+#include "engine.h"
+#include "kernels.h"
+
+/*
+ * Микробенчмарки вариантов внутреннего цикла, механизмов раздачи блоков
+ * и способов сбора сумм (Google Benchmark, цель bench).
+ * Ядра замеряются на одном блоке в одном потоке, планирование и редукция -
+ * полным расчетом runJob на общем пуле потоков с перебором
+ * числа потоков (1, 2, 4, ... до числа процессоров) и размера блока.
+ * Запуск, например: bench --benchmark_filter=dispatch --benchmark_repetitions=5
+ * */
+
+// Число итераций расчетов планирования и редукции
+static constexpr long long ITERATIONS = 1 << 24;
+
+// Размеры блока: от мелких (накладные расходы раздачи) до размера по заданию
+static const std::vector<long long> BLOCK_SIZES = {1 << 12, 1 << 16, 1 << 20, 8307040};
+
+// Перебор числа потоков и размера блока
+static void threadAndBlockArgs(benchmark::internal::Benchmark *benchmark) {
+    int processors = numberOfProcessors();
+    for (int threads = 1;; threads = std::min(threads * 2, processors)) {
+        for (long long blockSize : BLOCK_SIZES)
+            benchmark->Args({threads, blockSize});
+        if (threads == processors)
+            break;
+    }
+}
+
+/*
+ * Ядро на одном блоке [0, state.range(0)) при n = ITERATIONS:
+ * Reference - исходная формула с делением и pow (скалярно),
+ * Exact - шаг 1 / n и x * x вместо pow (strength reduction),
+ * ilpK - то же с K независимыми скалярными аккумуляторами,
+ * векторные - те же суммы в нескольких аккумуляторах.
+ * */
+static void kernelBenchmark(benchmark::State &state, const char *name, Precision precision) {
+    KernelInfo kernel;
+    if (!findKernel(name, precision, kernel)) {
+        state.SkipWithError("kernel is not supported by this CPU");
+        return;
+    }
+    long long blockSize = state.range(0);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(kernel.function(0, blockSize, ITERATIONS));
+    state.SetItemsProcessed(state.iterations() * blockSize);
+}
+
+BENCHMARK_CAPTURE(kernelBenchmark, scalar_pow, "scalar", Precision::Reference)
+        ->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK_CAPTURE(kernelBenchmark, scalar_reduced, "scalar", Precision::Exact)
+        ->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK_CAPTURE(kernelBenchmark, ilp2, "ilp2", Precision::Exact)
+        ->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK_CAPTURE(kernelBenchmark, ilp4, "ilp4", Precision::Exact)
+        ->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK_CAPTURE(kernelBenchmark, ilp8, "ilp8", Precision::Exact)
+        ->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK_CAPTURE(kernelBenchmark, sse2, "sse2", Precision::Exact)
+        ->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK_CAPTURE(kernelBenchmark, avx2, "avx2", Precision::Exact)
+        ->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK_CAPTURE(kernelBenchmark, avx512, "avx512", Precision::Exact)
+        ->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK_CAPTURE(kernelBenchmark, avx2_fast, "avx2", Precision::Fast)
+        ->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+
+// Полный расчет на state.range(0) потоках с блоком state.range(1)
+static void jobBenchmark(benchmark::State &state, SchedulingMode mode, ReductionMode reduction) {
+    JobConfig config;
+    config.threads = (int) state.range(0);
+    config.blockSize = state.range(1);
+    config.iterations = ITERATIONS;
+    config.mode = mode;
+    config.reduction = reduction;
+    KernelInfo kernel;
+    double exactValue;
+    if (!prepareJob(config, kernel, exactValue)) {
+        state.SkipWithError("invalid job configuration");
+        return;
+    }
+
+    const std::atomic<bool> cancelled(false);
+    double setupTime = 0, reductionTime = 0, imbalance = 0;
+    for (auto _ : state) {
+        CalculationResult result = runJob(config, cancelled);
+        benchmark::DoNotOptimize(result.pi);
+        setupTime += result.setupTime;
+        reductionTime += result.reductionTime;
+        imbalance += loadImbalance(result);
+    }
+    double runs = (double) state.iterations();
+    state.SetItemsProcessed(state.iterations() * ITERATIONS);
+    state.counters["setup_us"] = setupTime * 1000 / runs;
+    state.counters["reduction_us"] = reductionTime * 1000 / runs;
+    state.counters["imbalance"] = imbalance / runs;
+}
+
+/*
+ * Раздача блоков: приостановка и возобновление потоков главным (handshake),
+ * общий атомарный счетчик (self), деки с захватом (stealing), убывающие блоки (guided).
+ * */
+BENCHMARK_CAPTURE(jobBenchmark, dispatch_handshake, SchedulingMode::Handshake, ReductionMode::Pairwise)
+        ->Apply(threadAndBlockArgs)->UseRealTime();
+BENCHMARK_CAPTURE(jobBenchmark, dispatch_self, SchedulingMode::SelfScheduling, ReductionMode::Pairwise)
+        ->Apply(threadAndBlockArgs)->UseRealTime();
+BENCHMARK_CAPTURE(jobBenchmark, dispatch_stealing, SchedulingMode::WorkStealing, ReductionMode::Pairwise)
+        ->Apply(threadAndBlockArgs)->UseRealTime();
+BENCHMARK_CAPTURE(jobBenchmark, dispatch_guided, SchedulingMode::Guided, ReductionMode::Pairwise)
+        ->Apply(threadAndBlockArgs)->UseRealTime();
+
+/*
+ * Сбор сумм при самопланировании: std::atomic<double> (atomic),
+ * слоты потоков на отдельных кэш-линиях по порядку (sequential), деревом (pairwise),
+ * с компенсацией (kahan) и дерево по суммам блоков (deterministic).
+ * */
+BENCHMARK_CAPTURE(jobBenchmark, reduction_atomic, SchedulingMode::SelfScheduling, ReductionMode::Atomic)
+        ->Apply(threadAndBlockArgs)->UseRealTime();
+BENCHMARK_CAPTURE(jobBenchmark, reduction_sequential, SchedulingMode::SelfScheduling, ReductionMode::Sequential)
+        ->Apply(threadAndBlockArgs)->UseRealTime();
+BENCHMARK_CAPTURE(jobBenchmark, reduction_pairwise, SchedulingMode::SelfScheduling, ReductionMode::Pairwise)
+        ->Apply(threadAndBlockArgs)->UseRealTime();
+BENCHMARK_CAPTURE(jobBenchmark, reduction_kahan, SchedulingMode::SelfScheduling, ReductionMode::Kahan)
+        ->Apply(threadAndBlockArgs)->UseRealTime();
+BENCHMARK_CAPTURE(jobBenchmark, reduction_deterministic, SchedulingMode::SelfScheduling, ReductionMode::Deterministic)
+        ->Apply(threadAndBlockArgs)->UseRealTime();
+
+int main(int argc, char *argv[]) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    // Потоки пула переживают расчеты и завершаются явно
+    shutdownWorkers();
+    return 0;
+}
@@ -0,0 +1,45 @@
+# Проверка кэша результатов (ctest, см. CMakeLists.txt):
+# расчет на 2N после расчета на N с тем же кэшем досчитывает только новые узлы
+# (Cached iterations: N of 2N) и для трапеций и Симпсона совпадает с расчетом без кэша.
+# Суммы из кэша складываются в другом порядке, поэтому совпадение - до 1e-13.
+# Запуск: cmake -DPROGRAM=<путь к программе> -P cache_test.cmake
+
+set(ITERATIONS 1000000)
+math(EXPR DOUBLED "${ITERATIONS} * 2")
+set(BLOCK_SIZE 100003)
+set(CACHE_FILE ${CMAKE_CURRENT_BINARY_DIR}/cache_test.bin)
+
+# Запуск программы; integral - результат в единицах 1e-15, cached - строка Cached iterations
+function(run_program rule iterations integral cached)
+    execute_process(COMMAND ${PROGRAM} -t 2 --rule ${rule} -n ${iterations} -b ${BLOCK_SIZE} ${ARGN}
+                    OUTPUT_VARIABLE output RESULT_VARIABLE status)
+    if (NOT status EQUAL 0)
+        message(FATAL_ERROR "--rule ${rule} -n ${iterations} ${ARGN} failed (${status}):\n${output}")
+    endif ()
+    if (NOT output MATCHES "Integral = ([0-9]+)\\.([0-9]+)")
+        message(FATAL_ERROR "--rule ${rule} -n ${iterations}: no result in output:\n${output}")
+    endif ()
+    set(whole ${CMAKE_MATCH_1})
+    set(fraction "${CMAKE_MATCH_2}000000000000000")
+    string(SUBSTRING "${fraction}" 0 15 fraction)
+    math(EXPR value "${whole} * 1000000000000000 + ${fraction}")
+    set(${integral} ${value} PARENT_SCOPE)
+    string(REGEX MATCH "Cached iterations: [^\n]*" line "${output}")
+    set(${cached} "${line}" PARENT_SCOPE)
+endfunction()
+
+foreach (rule trapezoid simpson)
+    file(REMOVE ${CACHE_FILE})
+    run_program(${rule} ${ITERATIONS} coarse cached --cache ${CACHE_FILE})
+    run_program(${rule} ${DOUBLED} refined cached --cache ${CACHE_FILE})
+    run_program(${rule} ${DOUBLED} reference unused)
+    message(STATUS "--rule ${rule}: ${refined} (cached), ${reference} (uncached), ${cached}")
+    if (NOT cached STREQUAL "Cached iterations: ${ITERATIONS} of ${DOUBLED}")
+        message(FATAL_ERROR "--rule ${rule}: expected ${ITERATIONS} of ${DOUBLED} iterations from the cache, got '${cached}'")
+    endif ()
+    math(EXPR difference "${refined} - ${reference}")
+    if (difference LESS -100 OR difference GREATER 100)
+        message(FATAL_ERROR "--rule ${rule}: cached ${refined} differs from uncached ${reference}")
+    endif ()
+endforeach ()
+file(REMOVE ${CACHE_FILE})
@@ -0,0 +1,13 @@
+#ifndef CACHELINE_H
+#define CACHELINE_H
+
+#include <cstddef>
+
+/*
+ * Размер кэш-линии. Данные, которые пишут разные потоки,
+ * выравниваются по этой границе, чтобы запись одного потока
+ * не инвалидировала кэш-линию с данными другого (false sharing).
+ * */
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+#endif //CACHELINE_H
@@ -0,0 +1,31 @@
+# Проверка детерминированной редукции (ctest, см. CMakeLists.txt):
+# -r deterministic при одних N и размере блока должен давать побитово одинаковое Пи
+# при любом числе потоков и режиме планирования. Пи выводится с max_digits10 знаками,
+# поэтому совпадение строк означает совпадение битов.
+# Запуск: cmake -DPROGRAM=<путь к программе> -P deterministic_test.cmake
+
+set(ITERATIONS 10000000)
+# Размер блока не делит N, чтобы последний блок был неполным
+set(BLOCK_SIZE 100003)
+
+unset(reference)
+foreach (mode handshake self stealing)
+    foreach (threads 1 2 3 7 16)
+        execute_process(COMMAND ${PROGRAM} -t ${threads} -m ${mode} -r deterministic
+                                -n ${ITERATIONS} -b ${BLOCK_SIZE}
+                        OUTPUT_VARIABLE output RESULT_VARIABLE status)
+        if (NOT status EQUAL 0)
+            message(FATAL_ERROR "-t ${threads} -m ${mode} failed (${status}):\n${output}")
+        endif ()
+        string(REGEX MATCH "Pi = [^\n]*" pi "${output}")
+        if (NOT pi)
+            message(FATAL_ERROR "-t ${threads} -m ${mode}: no result in output:\n${output}")
+        endif ()
+        message(STATUS "-t ${threads} -m ${mode}: ${pi}")
+        if (NOT DEFINED reference)
+            set(reference "${pi}")
+        elseif (NOT pi STREQUAL reference)
+            message(FATAL_ERROR "-t ${threads} -m ${mode}: ${pi} differs from ${reference}")
+        endif ()
+    endforeach ()
+endforeach ()
@@ -0,0 +1,255 @@
+#include "distributed.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "network.h"
+
+/*
+ * Очередь частей координатора.
+ * Часть либо еще не выдана (next или возвращена в retry),
+ * либо считается на узле (inFlight), либо готова (done).
+ * Поток соединения, не получивший части, ждет, пока не освободится
+ * часть отключившегося узла или не закончатся считающиеся части.
+ * */
+struct ShardQueue {
+    std::mutex mutex;
+    std::condition_variable changed;
+    long long count = 0;
+    long long next = 0;
+    std::deque<long long> retry;
+    long long inFlight = 0;
+    std::vector<double> sums;
+    std::vector<bool> done;
+
+    // Номер очередной части или -1, если выдавать больше нечего
+    long long take() {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return !retry.empty() || next < count || inFlight == 0; });
+        long long shard = -1;
+        if (!retry.empty()) {
+            shard = retry.front();
+            retry.pop_front();
+        } else if (next < count) {
+            shard = next++;
+        }
+        if (shard >= 0)
+            inFlight++;
+        return shard;
+    }
+
+    void complete(long long shard, double sum) {
+        std::lock_guard<std::mutex> lock(mutex);
+        sums[shard] = sum;
+        done[shard] = true;
+        inFlight--;
+        changed.notify_all();
+    }
+
+    void giveBack(long long shard) {
+        std::lock_guard<std::mutex> lock(mutex);
+        retry.push_back(shard);
+        inFlight--;
+        changed.notify_all();
+    }
+};
+
+// Попарное сложение сумм частей [first, last)
+static double pairwiseSum(const std::vector<double> &sums, size_t first, size_t last) {
+    if (last - first == 1)
+        return sums[first];
+    size_t middle = first + (last - first) / 2;
+    return pairwiseSum(sums, first, middle) + pairwiseSum(sums, middle, last);
+}
+
+static std::string formatSum(double sum) {
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%a", sum);
+    return buffer;
+}
+
+// Обслуживание одного узла координатором
+static void serveNode(Socket connection, const DistributedJob &job, long long shardSize,
+                      ShardQueue &queue, NodeReport &report) {
+    std::string line;
+    std::string command;
+    if (!receiveLine(connection, line) || !(std::istringstream(line) >> command >> report.threads)
+        || command != "HELLO") {
+        std::cerr << "Node " << report.name << ": unexpected greeting" << std::endl;
+        closeSocket(connection);
+        return;
+    }
+    std::ostringstream jobLine;
+    jobLine << "JOB " << job.iterations << ' ' << job.integrand << ' ' << job.rule << ' ' << job.precision << ' ' << job.accumulation;
+    if (!sendLine(connection, jobLine.str())) {
+        closeSocket(connection);
+        return;
+    }
+
+    for (long long shard; (shard = queue.take()) >= 0;) {
+        long long first = shard * shardSize;
+        long long last = std::min(first + shardSize, job.iterations);
+
+        std::string sumText;
+        double time = 0;
+        bool received = sendLine(connection, "SHARD " + std::to_string(first) + " " + std::to_string(last))
+                        && receiveLine(connection, line)
+                        && std::istringstream(line) >> command >> sumText >> time && command == "SUM";
+        if (!received) {
+            std::cerr << "Node " << report.name << " disconnected, shard " << shard << " will be reassigned"
+                      << std::endl;
+            queue.giveBack(shard);
+            closeSocket(connection);
+            return;
+        }
+
+        queue.complete(shard, std::strtod(sumText.c_str(), nullptr));
+        report.shards++;
+        report.busyTime += time;
+    }
+
+    sendLine(connection, "DONE");
+    closeSocket(connection);
+}
+
+// Подряд неудачных accept, после которых координатор прекращает ждать узлы
+static constexpr int MAX_ACCEPT_FAILURES = 8;
+
+static void closeConnections(const std::vector<Socket> &connections) {
+    for (Socket connection : connections)
+        closeSocket(connection);
+}
+
+bool runCoordinator(int port, int nodes, const DistributedJob &job, long long shardSize, int connectTimeout,
+                    DistributedResult &result) {
+    if (!networkStartup())
+        return false;
+    Socket listener = listenOn(port);
+    if (listener == NO_SOCKET)
+        return false;
+
+    ShardQueue queue;
+    queue.count = job.iterations / shardSize + (job.iterations % shardSize ? 1 : 0);
+    queue.sums.assign(queue.count, 0);
+    queue.done.assign(queue.count, false);
+
+    // Ждем все узлы, чтобы первые части не достались только самым быстрым
+    std::vector<Socket> connections;
+    result.nodes.clear();
+    std::cout << "Waiting for " << nodes << " nodes on port " << port << std::endl;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(connectTimeout);
+    int failures = 0;
+    while ((int) connections.size() < nodes) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+        bool pending = remaining > 0 && waitForConnection(listener, (int) remaining);
+        if (!pending && std::chrono::steady_clock::now() >= deadline) {
+            std::cerr << "Only " << connections.size() << " of " << nodes << " nodes connected within "
+                      << connectTimeout / 1000.0 << " s" << std::endl;
+            closeConnections(connections);
+            closeSocket(listener);
+            return false;
+        }
+        if (!pending)
+            continue;
+
+        std::string name;
+        Socket connection = acceptConnection(listener, name);
+        if (connection == NO_SOCKET) {
+            if (++failures < MAX_ACCEPT_FAILURES)
+                continue;
+            std::cerr << "Could not accept node connections, giving up after " << failures << " failures"
+                      << std::endl;
+            closeConnections(connections);
+            closeSocket(listener);
+            return false;
+        }
+        failures = 0;
+        std::cout << "Node " << name << " connected" << std::endl;
+        connections.push_back(connection);
+        result.nodes.push_back({name, 0, 0, 0});
+    }
+    closeSocket(listener);
+
+    // Время расчета отсчитывается с момента, когда подключились все узлы
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> servers;
+    for (size_t i = 0; i < connections.size(); i++)
+        servers.emplace_back(serveNode, connections[i], std::cref(job), shardSize, std::ref(queue),
+                             std::ref(result.nodes[i]));
+    for (std::thread &server : servers)
+        server.join();
+
+    long long missing = 0;
+    for (bool shardDone : queue.done)
+        missing += !shardDone;
+    if (missing) {
+        std::cerr << missing << " of " << queue.count << " shards were not computed: all nodes disconnected"
+                  << std::endl;
+        return false;
+    }
+
+    result.sum = pairwiseSum(queue.sums, 0, queue.sums.size());
+    result.shards = queue.count;
+    result.time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+bool runNode(const std::string &host, int port, int threads, JobConfigurator configure, ShardCalculator calculate) {
+    if (!networkStartup())
+        return false;
+    Socket connection = connectTo(host, port);
+    if (connection == NO_SOCKET)
+        return false;
+
+    std::string line, command;
+    if (!sendLine(connection, "HELLO " + std::to_string(threads)) || !receiveLine(connection, line)) {
+        std::cerr << "Coordinator closed the connection" << std::endl;
+        closeSocket(connection);
+        return false;
+    }
+    DistributedJob job;
+    if (!(std::istringstream(line) >> command >> job.iterations >> job.integrand >> job.rule >> job.precision
+                                       >> job.accumulation)
+        || command != "JOB" || !configure(job)) {
+        std::cerr << "Unsupported job: " << line << std::endl;
+        closeSocket(connection);
+        return false;
+    }
+
+    long long shards = 0;
+    while (receiveLine(connection, line)) {
+        long long first, last;
+        std::istringstream message(line);
+        message >> command;
+        if (command == "DONE") {
+            std::cout << "Computed " << shards << " shards" << std::endl;
+            closeSocket(connection);
+            return true;
+        }
+        if (command != "SHARD" || !(message >> first >> last)) {
+            std::cerr << "Unexpected message: " << line << std::endl;
+            break;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        double sum = calculate(first, last);
+        double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (!sendLine(connection, "SUM " + formatSum(sum) + " " + std::to_string(time)))
+            break;
+        shards++;
+    }
+
+    std::cerr << "Connection to coordinator lost" << std::endl;
+    closeSocket(connection);
+    return false;
+}
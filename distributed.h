@@ -0,0 +1,72 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include <string>
+#include <vector>
+
+/*
+ * Распределенный режим: координатор делит итерации [0, N) на части
+ * (shards) и раздает их по TCP узлам-исполнителям; каждый узел считает
+ * свою часть локальным многопоточным расчетом и возвращает
+ * ненормированную сумму ядра. Суммы частей складываются попарно
+ * в порядке частей, поэтому результат не зависит от того,
+ * какой узел какую часть посчитал.
+ *
+ * Протокол - текстовые строки:
+ *      узел -> координатор: HELLO <число потоков>
+ *      координатор -> узел: JOB <N> <функция> <формула> <точность> <накопление>
+ *      координатор -> узел: SHARD <первая итерация> <последняя + 1>
+ *      узел -> координатор: SUM <сумма в шестнадцатеричном виде %a> <время, мс>
+ *      координатор -> узел: DONE
+ * Части выдаются по одной по мере готовности (самопланирование узлов).
+ * Если узел отключился, не вернув результат, его часть выдается другому узлу.
+ * */
+
+// Параметры расчета, одинаковые на всех узлах
+struct DistributedJob {
+    long long iterations;
+    std::string integrand;
+    std::string rule;
+    std::string precision;
+    std::string accumulation;
+};
+
+// Вклад одного узла
+struct NodeReport {
+    std::string name;
+    int threads;
+    long long shards;
+    // Время расчета частей на узле, мс
+    double busyTime;
+};
+
+struct DistributedResult {
+    // Сумма ядра по всем итерациям до нормировки
+    double sum;
+    long long shards;
+    std::vector<NodeReport> nodes;
+    // Время расчета с момента подключения всех узлов, мс
+    double time;
+};
+
+/*
+ * Координатор: ждет nodes соединений на порту port не дольше
+ * connectTimeout мс, затем раздает части по shardSize итераций.
+ * Возвращает false, если за connectTimeout подключились не все узлы,
+ * прием соединений раз за разом не удавался, какие-то части не удалось
+ * посчитать (все узлы отключились) или не удалось открыть порт.
+ * */
+bool runCoordinator(int port, int nodes, const DistributedJob &job, long long shardSize, int connectTimeout,
+                    DistributedResult &result);
+
+/*
+ * Исполнитель: соединяется с координатором host:port и считает выданные части.
+ * configure применяет параметры задания (false - задание не поддерживается),
+ * calculate возвращает ненормированную сумму ядра по [first, last).
+ * */
+typedef bool (*JobConfigurator)(const DistributedJob &job);
+typedef double (*ShardCalculator)(long long first, long long last);
+
+bool runNode(const std::string &host, int port, int threads, JobConfigurator configure, ShardCalculator calculate);
+
+#endif //DISTRIBUTED_H
@@ -0,0 +1,60 @@
+#include "energy.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+static const char *POWERCAP_PATH = "/sys/class/powercap";
+
+/*
+ * Каталоги пакетов: intel-rapl:0, intel-rapl:1, ...
+ * (вложенные домены intel-rapl:0:0 - ядра, память - входят в пакет и пропускаются).
+ * */
+static std::vector<std::filesystem::path> findPackageZones() {
+    std::vector<std::filesystem::path> zones;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(POWERCAP_PATH, error)) {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("intel-rapl:", 0) == 0 && name.find(':') == name.rfind(':'))
+            zones.push_back(entry.path());
+    }
+    return zones;
+}
+
+// Пакеты не меняются во время работы, каталог просматривается один раз
+static const std::vector<std::filesystem::path> &packageZones() {
+    static const std::vector<std::filesystem::path> zones = findPackageZones();
+    return zones;
+}
+
+static bool readCounter(const std::filesystem::path &file, long long &value) {
+    std::ifstream input(file);
+    return (bool) (input >> value);
+}
+
+std::vector<long long> readPackageEnergy() {
+    const auto &zones = packageZones();
+    std::vector<long long> energy;
+    for (const auto &zone : zones) {
+        long long value;
+        if (!readCounter(zone / "energy_uj", value))
+            return {};
+        energy.push_back(value);
+    }
+    return energy;
+}
+
+double consumedEnergy(const std::vector<long long> &before, const std::vector<long long> &after) {
+    const auto &zones = packageZones();
+    if (before.empty() || before.size() != after.size() || before.size() != zones.size())
+        return -1;
+    double microjoules = 0;
+    for (size_t i = 0; i < before.size(); i++) {
+        long long delta = after[i] - before[i];
+        long long range;
+        if (delta < 0 && readCounter(zones[i] / "max_energy_range_uj", range))
+            delta += range;
+        microjoules += (double) delta;
+    }
+    return microjoules / 1e6;
+}
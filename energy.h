@@ -0,0 +1,25 @@
+#ifndef ENERGY_H
+#define ENERGY_H
+
+/*
+ * Энергия, потребленная пакетами процессора (RAPL), для оценки
+ * пропускной способности на ватт (--energy).
+ * Счетчики читаются из /sys/class/powercap/intel-rapl:N/energy_uj
+ * (Linux, Intel и AMD Zen); с Linux 5.10 файл по умолчанию доступен
+ * только root. В Windows RAPL доступен только драйверам, поэтому
+ * там и при недоступных счетчиках энергия не измеряется.
+ * Счетчик учитывает весь пакет, т.е. и другие процессы на тех же ядрах.
+ * */
+
+#include <vector>
+
+// Показания счетчиков всех пакетов, мкДж; пусто - счетчики недоступны.
+std::vector<long long> readPackageEnergy();
+
+/*
+ * Энергия между двумя показаниями, Дж, с учетом переполнения счетчиков
+ * (max_energy_range_uj); -1, если показаний нет.
+ * */
+double consumedEnergy(const std::vector<long long> &before, const std::vector<long long> &after);
+
+#endif //ENERGY_H
@@ -0,0 +1,1248 @@
+#include "engine.h"
+
+#include <iostream>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "cacheline.h"
+#include "energy.h"
+#include "offload.h"
+#include "parallelalgorithm.h"
+#include "perfcounters.h"
+#include "progressive.h"
+#include "trace.h"
+#include "workstealing.h"
+
+/*
+ * Слот потока, занимает целую кэш-линию:
+ * частичная сумма и статистика загрузки потока.
+ * */
+struct alignas(CACHE_LINE_SIZE) ThreadSlot {
+    double partialPi;
+    // Время, затраченное потоком на расчет блоков (без простоя), мс
+    double busyTime;
+    // Число обсчитанных потоком блоков и итераций
+    long long blocks;
+    long long iterations;
+    // Число блоков, захваченных у других потоков (режим WorkStealing)
+    long long steals;
+    // Число попыток захвата, не принесших блока (дек пуст или блок перехвачен)
+    long long failedSteals;
+    // Счетчики процессора за расчет (если collectCounters)
+    PerfCounters counters;
+    // Слот выделен allocateLocal (иначе обычным new, см. allocateSlot)
+    bool local;
+};
+
+/*
+ * Слот потока на странице его NUMA-узла; если allocateLocal
+ * не выделил память, слот выделяется обычным new (без учета узла).
+ * */
+ThreadSlot *allocateSlot() {
+    void *memory = allocateLocal(sizeof(ThreadSlot));
+    ThreadSlot *slot = memory ? new(memory) ThreadSlot() : new ThreadSlot();
+    slot->local = memory != nullptr;
+    return slot;
+}
+
+void releaseSlot(ThreadSlot *slot) {
+    if (!slot->local) {
+        delete slot;
+        return;
+    }
+    slot->~ThreadSlot();
+    freeLocal(slot, sizeof(ThreadSlot));
+}
+
+/*
+ * Состояние одного расчета (задания): параметры, копируемые из JobConfig
+ * в runJob, и общие для потоков расчета счетчики и суммы.
+ * Контекст живет в стеке runJob и передается потокам через createWorkers,
+ * поэтому задания с разными контекстами выполняются одновременно
+ * на разных потоках пула (см. jobs.h).
+ * */
+struct JobContext {
+    /*
+     * Все размеры 64-битные, чтобы число итераций
+     * могло превышать 2^31 (вплоть до 10^12 и больше).
+     * */
+
+    // Точность - 100000000 по заданию (количество итераций)
+    long long numberOfIterations = 100000000;
+
+    // Размер блока - 10*номерСтудБилета = 830704*10 = 8307040
+    long long blockSize = 8307040;
+
+    /*
+     * Обсчитываемые итерации [rangeStart, rangeEnd) из numberOfIterations.
+     * Обычно это все итерации; в распределенном режиме (см. distributed.h)
+     * узел считает только выданную ему часть.
+     * */
+    long long rangeStart = 0;
+    long long rangeEnd = 0;
+
+    // Количество блоков: распределяем итерации диапазона по blockSize блокам.
+    // Если без остатка не делится, то добавляем еще один блок
+    long long numberOfBlocks = 0;
+
+    /*
+     * Автоматический подбор размера блока (см. tuneBlockSize):
+     * размер блока вычисляется перед каждым расчетом
+     * по числу потоков и измеренной стоимости итерации.
+     * */
+    bool autoBlockSize = false;
+
+    // Число потоков расчета и их группа в пуле (см. backend.h)
+    int numberOfWorkers = 0;
+    WorkerGroup *workers = nullptr;
+
+    // Подынтегральная функция для режима ParallelAlgorithm (ядра в нем не используются)
+    std::string parallelIntegrand = "pi";
+
+    SchedulingMode schedulingMode = SchedulingMode::SelfScheduling;
+
+    /*
+     * Ядро расчета, которым потоки обсчитывают блоки.
+     * Выбирается в runJob по JobConfig (см. findKernel в kernels.h).
+     * */
+    KernelInfo kernel;
+
+    /*
+     * Функция, которой считаются блоки расчета:
+     * kernel.function или его экземпляр для текущих N и размера блока
+     * (см. specializeKernel), если specializeKernels и такой экземпляр есть.
+     * */
+    Kernel blockKernel = nullptr;
+    bool specializeKernels = true;
+
+    /*
+     * Точное значение вычисляемого интеграла для оценки погрешности:
+     * Пи для исходной формулы, для других функций задается findIntegrand.
+     * */
+    double exactValue = PiIntegrand::exact();
+
+    ReductionMode reductionMode = ReductionMode::Pairwise;
+
+    // Сбор счетчиков процессора по потокам (см. perfcounters.h)
+    bool collectCounters = false;
+
+    // Доля времени работы потоков и их приоритет (см. JobConfig::dutyCycle)
+    double dutyCycle = 1;
+    bool idlePriority = false;
+    // Хотя бы одному потоку не удалось сменить приоритет
+    std::atomic<bool> priorityFailed = false;
+    // Промежуточные оценки прогрессивного расчета
+    ProgressCallback progressCallback = nullptr;
+
+    /*
+     * Массив указателей на слоты потоков.
+     * Каждый поток сам выделяет свой слот через allocateLocal,
+     * т.е. на странице памяти своего NUMA-узла.
+     * */
+    ThreadSlot **threadSlots = nullptr;
+
+    // Политика привязки потоков к процессорам (см. affinity.h)
+    AffinityPolicy affinityPolicy = AffinityPolicy::None;
+
+    /*
+     * std::atomic - атомарные операции в C++ начиная с С++11
+     * В С++20 добавлены атомарные операции сложения и вычитания для floating-point типов
+     * (source: https://en.cppreference.com/w/cpp/atomic/atomic#Specializations_for_floating-point_types)
+     * */
+    alignas(CACHE_LINE_SIZE) std::atomic<long long> nextBlock = 0;
+    // Первая еще не распределенная итерация (для режима Guided)
+    alignas(CACHE_LINE_SIZE) std::atomic<long long> nextIteration = 0;
+    // Деки блоков потоков (для режима WorkStealing)
+    WorkStealingDeque *deques = nullptr;
+
+    /*
+     * Прогрессивный расчет (включается, если задан бюджет времени или целевая погрешность).
+     * Потоки забирают блоки в порядке bisectionOrder, после каждого блока
+     * главный поток выводит текущую оценку интеграла и ее погрешности
+     * (см. ProgressiveEstimate) и останавливает расчет, когда
+     * истекло timeBudget мс или оценка погрешности не больше targetError.
+     * Начатые блоки дочитываются, поэтому бюджет может быть превышен
+     * на время расчета одного блока.
+     * */
+    double timeBudget = 0;
+    double targetError = 0;
+
+    bool progressive() const {
+        return timeBudget > 0 || targetError > 0;
+    }
+
+    // Порядок обхода блоков и суммы блоков по позициям в нем (NaN - блок еще не готов)
+    std::vector<long long> blockOrder;
+    std::atomic<double> *blockSums = nullptr;
+    // Число потоков, закончивших прогрессивный расчет
+    std::atomic<int> finishedWorkers = 0;
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> stopRequested = false;
+
+    // Флаг отмены задания (см. runJob), опрашивается между блоками
+    const std::atomic<bool> *cancelToken = nullptr;
+
+    bool cancelRequested() const {
+        return cancelToken->load(std::memory_order_relaxed);
+    }
+    std::chrono::steady_clock::time_point deadline;
+    ProgressiveEstimate progressiveEstimate;
+    /*
+     * Гетерогенный расчет (--offload, только SelfScheduling): к потокам процессора
+     * добавляется поток с номером offloadWorker, который забирает из nextBlock
+     * по offloadBlocks подряд идущих блоков и считает их на ускорителе (см. offload.h).
+     * Такой крупный захват окупает запуск на устройстве, а хвост
+     * расчета все равно достается потокам процессора по одному блоку.
+     * offloadWorker = -1 - ускоритель не используется.
+     * */
+    bool offload = false;
+    long long offloadBlocks = 0;
+    int offloadWorker = -1;
+
+    // Учет гибридных процессоров (см. weightedChunk): веса потоков расчета
+    bool hybridScheduling = false;
+    std::vector<double> threadWeights;
+
+    /*
+     * Суммы блоков по номерам (ReductionMode::Deterministic), иначе nullptr.
+     * Каждый элемент записывается один раз за расчет, поэтому соседние
+     * суммы в одной кэш-линии почти не мешают потокам.
+     * */
+    double *blockPartials = nullptr;
+
+    // pi на отдельной кэш-линии, чтобы fetch_add по nextBlock не конкурировал с ним
+    alignas(CACHE_LINE_SIZE) std::atomic<double> pi = 0;
+};
+
+/*
+ * Расчет итераций [startIteration, endIteration) с учетом
+ * времени работы потока в его слоте.
+ * */
+double calculateRange(JobContext &job, ThreadSlot &slot, long long startIteration, long long endIteration) {
+    TRACE_SCOPE(TraceEvent::Block, startIteration);
+    auto start = std::chrono::steady_clock::now();
+    double sum = job.blockKernel(startIteration, endIteration, job.numberOfIterations);
+    auto busy = std::chrono::steady_clock::now() - start;
+    slot.busyTime += std::chrono::duration<double, std::milli>(busy).count();
+    slot.blocks++;
+    slot.iterations += endIteration - startIteration;
+    /*
+     * Пауза после блока, чтобы поток загружал свое ядро на dutyCycle.
+     * Пауза может длиться секунды (малый dutyCycle, крупный блок),
+     * поэтому поток спит отрезками не длиннее PAUSE_SLICE и проверяет отмену.
+     * */
+    if (job.dutyCycle < 1) {
+        TRACE_SCOPE(TraceEvent::Wait, startIteration);
+        const auto PAUSE_SLICE = std::chrono::milliseconds(10);
+        auto resume = std::chrono::steady_clock::now()
+                      + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                              busy * ((1 - job.dutyCycle) / job.dutyCycle));
+        for (auto now = std::chrono::steady_clock::now(); now < resume && !job.cancelRequested();
+             now = std::chrono::steady_clock::now())
+            std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(resume - now, PAUSE_SLICE));
+    }
+    return sum;
+}
+
+/*
+ * Учет гибридных процессоров (--hybrid, потоки привязаны к процессорам).
+ * Блок потока умножается на вес threadWeights[i] - отношение пропускной
+ * способности класса его ядра (см. LogicalProcessor::efficiencyClass)
+ * к самому быстрому из используемых классов. Так блок на E-ядре
+ * считается примерно столько же, сколько блок на P-ядре, и последний блок
+ * E-ядра не затягивает конец расчета.
+ * Пропускная способность классов (итераций в мс на поток) измеряется
+ * в каждом расчете с привязкой потоков, а перед первым расчетом
+ * с неизмеренными классами - пробным расчетом (см. calibrateClasses).
+ * */
+static std::map<int, double> classThroughput;
+// Расчеты разных заданий обновляют классы одновременно
+static std::mutex classThroughputMutex;
+
+// Блок chunk итераций с учетом веса потока
+long long weightedChunk(JobContext &job, int threadIndex, long long chunk) {
+    if (!job.hybridScheduling)
+        return chunk;
+    return std::max(1LL, (long long) (chunk * job.threadWeights[threadIndex]));
+}
+
+// Веса потоков по их размещению и измеренной пропускной способности классов
+void assignThreadWeights(JobContext &job, const std::vector<LogicalProcessor> &placement) {
+    job.threadWeights.assign(job.numberOfWorkers, 1);
+    std::lock_guard<std::mutex> lock(classThroughputMutex);
+    double fastest = 0;
+    for (const LogicalProcessor &processor : placement) {
+        auto measured = classThroughput.find(processor.efficiencyClass);
+        if (measured == classThroughput.end())
+            return;
+        fastest = std::max(fastest, measured->second);
+    }
+    for (size_t i = 0; i < placement.size(); i++)
+        job.threadWeights[i] = classThroughput[placement[i].efficiencyClass] / fastest;
+}
+
+/*
+ * Пробный расчет для классов без измеренной пропускной способности:
+ * каждый поток, привязанный как в placement, считает CALIBRATION_ITERATIONS
+ * итераций ядром расчета (как SAMPLE_ITERATIONS в tuneBlockSize).
+ * Потоки одного класса считают одновременно, как и в самом расчете.
+ * */
+const long long CALIBRATION_ITERATIONS = 1 << 18;
+
+// Задание пробного расчета: ядро и время каждого потока
+struct CalibrationContext {
+    Kernel function;
+    std::vector<double> times;
+};
+
+void calibrateIteration(void *context, int threadIndex) {
+    auto &calibration = *(CalibrationContext *) context;
+    auto start = std::chrono::steady_clock::now();
+    volatile double sample = calibration.function(0, CALIBRATION_ITERATIONS, CALIBRATION_ITERATIONS);
+    (void) sample;
+    calibration.times[threadIndex] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()
+                                                                              - start).count();
+}
+
+void calibrateClasses(JobContext &job, const std::vector<LogicalProcessor> &placement) {
+    std::map<int, std::pair<int, double>> totals;
+    for (const LogicalProcessor &processor : placement)
+        totals[processor.efficiencyClass];
+    bool measured = true;
+    {
+        std::lock_guard<std::mutex> lock(classThroughputMutex);
+        for (const auto &total : totals)
+            measured = measured && classThroughput.count(total.first);
+    }
+    // Один класс - веса равны 1 и без измерений
+    if (measured || totals.size() == 1)
+        return;
+
+    int numberOfThreads = (int) placement.size();
+    CalibrationContext calibration = {job.kernel.function, std::vector<double>(numberOfThreads, 0)};
+    WorkerGroup *group = createWorkers(numberOfThreads, calibrateIteration, &calibration);
+    for (int i = 0; i < numberOfThreads; i++)
+        pinWorker(group, i, placement[i]);
+    startWorkers(group);
+    joinWorkers(group);
+
+    for (int i = 0; i < numberOfThreads; i++) {
+        auto &total = totals[placement[i].efficiencyClass];
+        total.first++;
+        total.second += calibration.times[i];
+    }
+    std::lock_guard<std::mutex> lock(classThroughputMutex);
+    for (const auto &total : totals) {
+        if (total.second.second > 0)
+            classThroughput[total.first] = CALIBRATION_ITERATIONS * total.second.first / total.second.second;
+    }
+}
+
+// Обновление пропускной способности классов по слотам потоков последнего расчета
+void measureClassThroughput(JobContext &job, const std::vector<LogicalProcessor> &placement) {
+    std::map<int, std::pair<long long, double>> totals;
+    for (size_t i = 0; i < placement.size(); i++) {
+        auto &total = totals[placement[i].efficiencyClass];
+        total.first += job.threadSlots[i]->iterations;
+        total.second += job.threadSlots[i]->busyTime;
+    }
+    std::lock_guard<std::mutex> lock(classThroughputMutex);
+    for (const auto &total : totals) {
+        if (total.second.second > 0)
+            classThroughput[total.first] = total.second.first / total.second.second;
+    }
+}
+
+/*
+ * Расчет в режиме Guided.
+ * Поток забирает из nextIteration блок размером
+ * (оставшиеся итерации / число потоков), но не меньше blockSize
+ * (с --hybrid - умноженный на вес потока).
+ * Блок забирается через compare_exchange: если другой поток успел
+ * сдвинуть nextIteration, размер пересчитывается от нового значения.
+ * */
+double calculateGuided(JobContext &job, int threadIndex, ThreadSlot &slot) {
+    double threadPi = 0;
+    long long startIteration = job.nextIteration.load(std::memory_order_relaxed);
+    while (startIteration < job.rangeEnd && !job.cancelRequested()) {
+        long long chunk = weightedChunk(job, threadIndex,
+                                        std::max(job.blockSize, (job.rangeEnd - startIteration) / job.numberOfWorkers));
+        long long endIteration = std::min(startIteration + chunk, job.rangeEnd);
+        if (job.nextIteration.compare_exchange_weak(startIteration, endIteration, std::memory_order_relaxed)) {
+            threadPi += calculateRange(job, slot, startIteration, endIteration);
+            startIteration = job.nextIteration.load(std::memory_order_relaxed);
+        }
+    }
+    return threadPi;
+}
+
+/*
+ * Расчет в режиме SelfScheduling с --hybrid: блоки разного размера
+ * (blockSize, умноженный на вес потока), поэтому поток забирает
+ * итерации из nextIteration, а не номер блока из nextBlock.
+ * */
+double calculateWeighted(JobContext &job, int threadIndex, ThreadSlot &slot) {
+    double threadPi = 0;
+    long long chunk = weightedChunk(job, threadIndex, job.blockSize);
+    while (!job.cancelRequested()) {
+        long long startIteration = job.nextIteration.fetch_add(chunk, std::memory_order_relaxed);
+        if (startIteration >= job.rangeEnd)
+            break;
+        threadPi += calculateRange(job, slot, startIteration, std::min(startIteration + chunk, job.rangeEnd));
+    }
+    return threadPi;
+}
+
+// Сохранение суммы блока для детерминированной редукции
+double storeBlockSum(JobContext &job, long long block, double sum) {
+    if (job.blockPartials)
+        job.blockPartials[block] = sum;
+    return sum;
+}
+
+// Границы блока с номером block
+void blockBounds(JobContext &job, long long block, long long &startIteration, long long &endIteration) {
+    startIteration = job.rangeStart + block * job.blockSize;
+    endIteration = std::min(startIteration + job.blockSize, job.rangeEnd);
+}
+
+/*
+ * Расчет потоком ускорителя. Первым (как и у остальных потоков)
+ * считается блок с номером потока, затем блоки забираются по offloadBlocks.
+ * */
+double calculateOffload(JobContext &job, int threadIndex, ThreadSlot &slot) {
+    double threadPi = 0;
+    long long firstBlock = threadIndex, count = 1;
+    while (firstBlock < job.numberOfBlocks && !job.cancelRequested()) {
+        long long startIteration = job.rangeStart + firstBlock * job.blockSize;
+        long long endIteration = std::min(startIteration + count * job.blockSize, job.rangeEnd);
+        {
+            TRACE_SCOPE(TraceEvent::Block, startIteration);
+            auto start = std::chrono::steady_clock::now();
+            threadPi += offloadRange(startIteration, endIteration, job.numberOfIterations);
+            slot.busyTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                    .count();
+        }
+        slot.blocks += std::min(count, job.numberOfBlocks - firstBlock);
+        slot.iterations += endIteration - startIteration;
+        count = job.offloadBlocks;
+        firstBlock = job.nextBlock.fetch_add(count, std::memory_order_relaxed);
+    }
+    return threadPi;
+}
+
+/*
+ * Расчет в прогрессивном режиме: как SelfScheduling, но блоки берутся
+ * в порядке blockOrder, о каждом готовом блоке сообщается главному потоку,
+ * и новые блоки не берутся после остановки расчета.
+ * */
+double calculateProgressive(JobContext &job, int threadIndex, ThreadSlot &slot) {
+    double threadPi = 0;
+    while (!job.stopRequested.load(std::memory_order_relaxed) && !job.cancelRequested()
+           && (job.timeBudget <= 0 || std::chrono::steady_clock::now() < job.deadline)) {
+        long long position = job.nextBlock.fetch_add(1, std::memory_order_relaxed);
+        if (position >= job.numberOfBlocks)
+            break;
+
+        long long startIteration, endIteration;
+        blockBounds(job, job.blockOrder[position], startIteration, endIteration);
+        double sum = calculateRange(job, slot, startIteration, endIteration);
+        threadPi += sum;
+
+        job.blockSums[position].store(sum, std::memory_order_release);
+        notifyBlockDone(job.workers, threadIndex, false);
+    }
+
+    // Последнее сообщение потока: главный поток не ждет его блоков больше
+    job.finishedWorkers.fetch_add(1, std::memory_order_release);
+    notifyBlockDone(job.workers, threadIndex, false);
+    return threadPi;
+}
+
+/*
+ * Расчет в режиме WorkStealing.
+ * Сначала поток обсчитывает блоки своего дека, затем обходит деки
+ * остальных потоков по кругу, начиная со следующего.
+ * Новые блоки во время расчета не появляются, поэтому если
+ * за полный обход все деки оказались пусты (а не перехвачены
+ * в момент захвата), работа закончена.
+ * */
+double calculateStealing(JobContext &job, int threadIndex, ThreadSlot &slot) {
+    double threadPi = 0;
+    long long block, startIteration, endIteration;
+
+    while (!job.cancelRequested()) {
+        while (!job.cancelRequested() && job.deques[threadIndex].pop(block)) {
+            blockBounds(job, block, startIteration, endIteration);
+            threadPi += storeBlockSum(job, block, calculateRange(job, slot, startIteration, endIteration));
+        }
+
+        bool stolen = false, contended = false;
+        for (int k = 1; k < job.numberOfWorkers && !stolen; k++) {
+            int victim = (threadIndex + k) % job.numberOfWorkers;
+            WorkStealingDeque::StealResult stealResult;
+            {
+                TRACE_SCOPE(TraceEvent::Steal, victim);
+                stealResult = job.deques[victim].steal(block);
+            }
+            switch (stealResult) {
+                case WorkStealingDeque::StealResult::Success:
+                    stolen = true;
+                    slot.steals++;
+                    break;
+                case WorkStealingDeque::StealResult::Lost:
+                    contended = true;
+                    slot.failedSteals++;
+                    break;
+                case WorkStealingDeque::StealResult::Empty:
+                    slot.failedSteals++;
+                    break;
+            }
+        }
+
+        if (stolen) {
+            blockBounds(job, block, startIteration, endIteration);
+            threadPi += storeBlockSum(job, block, calculateRange(job, slot, startIteration, endIteration));
+        } else if (!contended) {
+            return threadPi;
+        }
+    }
+    return threadPi;
+}
+
+// Расчет блоков потоком threadIndex, сумма записывается в slot (или в pi)
+void calculateBlocks(JobContext &job, int threadIndex, ThreadSlot &slot) {
+
+    // "Часть" числа Пи, которую считаем в данном потоке
+    double threadPi = 0;
+
+    if (job.progressive() || job.schedulingMode == SchedulingMode::Guided
+        || job.schedulingMode == SchedulingMode::WorkStealing || threadIndex == job.offloadWorker
+        || job.hybridScheduling) {
+        threadPi = threadIndex == job.offloadWorker ? calculateOffload(job, threadIndex, slot)
+                   : job.progressive() ? calculateProgressive(job, threadIndex, slot)
+                   : job.schedulingMode == SchedulingMode::Guided ? calculateGuided(job, threadIndex, slot)
+                   : job.schedulingMode == SchedulingMode::WorkStealing ? calculateStealing(job, threadIndex, slot)
+                                                                    : calculateWeighted(job, threadIndex, slot);
+        slot.partialPi = threadPi;
+        if (job.reductionMode == ReductionMode::Atomic)
+            job.pi.fetch_add(threadPi, std::memory_order_relaxed);
+        return;
+    }
+
+    /*
+     * Получаем номер потока, который передали
+     * в функцию при создании потока.
+     * Номер потока также равен номеру
+     * первого блока для расчета.
+     * */
+    long long currentBlock = threadIndex;
+
+    /*
+     * Обсчитываем блоки в потоке
+     * пока номер текущего блока
+     * не превысил заданное количество блоков.
+     * */
+    while (currentBlock <= job.numberOfBlocks) {
+        /*
+         * При каждом заходе в цикл рассчитывается
+         * начальная и конечная граница обсчета.
+         * При этом начальная граница - currentBlock * blockSize,
+         * а currentBlock изменяется в конце цикла,
+         * получая значение nextBlock+1.
+         * Т.о. поток обсчитал блок, получил следущий блок, приостановился.
+         * */
+
+        /*
+         * Начальная границ обсчета.
+         * */
+        long long startIteration = job.rangeStart + currentBlock * job.blockSize;
+
+        /*
+         * Конечная граница обсчета.
+         * */
+        long long endIteration = startIteration + job.blockSize;
+
+        /*
+         * Если больше считать не нужно,
+         * то и цикл ниже запускать не нужно.
+         * */
+        if (endIteration > job.rangeEnd){
+            endIteration = job.rangeEnd;
+        }
+
+        /*
+         * Основная часть - расчет "фрагмента" Пи,
+         * соответствующего текущему блоку.
+         * */
+        if (startIteration < endIteration) {
+            threadPi += storeBlockSum(job, currentBlock, calculateRange(job, slot, startIteration, endIteration));
+        }
+
+        if (job.schedulingMode == SchedulingMode::Handshake) {
+            /*
+             * Сообщаем главному потоку об окончании расчета очередного блока.
+             * Если это был не последний блок и расчет не отменен, приостанавливаем выполнение потока.
+             * */
+            TRACE_SCOPE(TraceEvent::Parked, currentBlock);
+            notifyBlockDone(job.workers, threadIndex, job.nextBlock <= job.numberOfBlocks && !job.cancelRequested());
+        }
+
+        /*
+         * currentBlock = InterlockedExchangeAdd(&nextBlock, 1)
+         *            ^^^ тоже работает (currentBlock объявить как volatile long nextBlock = 0)
+         * source: https://docs.microsoft.com/en-us/windows/win32/api/winnt/nf-winnt-interlockedexchangeadd
+         * InterlockedExchangeAdd - атомарная операция сложения 32битных значений из Win32 API
+         * При этом в некотрых источниках написано, что volatile не предназначен
+         * стандартом языка для обеспечения атомарности операций в многопоточном программировании
+         * и volatile не рекомендуется использовать в таком контексте.
+         * */
+
+        /*
+         * Инкрементируем общий счетчик nextBlock и
+         * присваем полученное значение currentBlock.
+         * Таким образом поток получает следующий блок.
+         * */
+        if (job.cancelRequested())
+            break;
+        currentBlock = job.nextBlock.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /*
+     * Когда все блоки обсчитаны,
+     * собираем результаты вычислений данного потока
+     * в "глоабльное" Пи либо оставляем их в слоте потока
+     * для сбора в главном потоке.
+     * */
+    if (job.reductionMode == ReductionMode::Atomic)
+        job.pi.fetch_add(threadPi, std::memory_order_relaxed);
+    else
+        slot.partialPi = threadPi;
+}
+
+// Функция потока пула: context - JobContext задания
+void calculateIteration(void *context, int threadIndex) {
+    JobContext &job = *(JobContext *) context;
+    TRACE_THREAD(threadIndex);
+
+    // Слот этого потока
+    job.threadSlots[threadIndex] = allocateSlot();
+    ThreadSlot &slot = *job.threadSlots[threadIndex];
+
+    if (!setCurrentThreadIdlePriority(job.idlePriority))
+        job.priorityFailed.store(true, std::memory_order_relaxed);
+
+    if (!job.collectCounters) {
+        calculateBlocks(job, threadIndex, slot);
+        return;
+    }
+    // Счетчики включают и ожидание потока (приостановку в режиме Handshake)
+    PerfCounters before = readThreadCounters();
+    calculateBlocks(job, threadIndex, slot);
+    slot.counters = counterDelta(before, readThreadCounters());
+}
+
+// Попарное (древовидное) сложение слотов [first, last)
+double pairwiseSum(ThreadSlot *const *slots, int first, int last) {
+    if (last - first == 1)
+        return slots[first]->partialPi;
+    int middle = first + (last - first) / 2;
+    return pairwiseSum(slots, first, middle) + pairwiseSum(slots, middle, last);
+}
+
+// Попарное сложение сумм блоков [first, last) по номерам
+double pairwiseBlockSum(JobContext &job, long long first, long long last) {
+    if (last - first == 1)
+        return job.blockPartials[first];
+    long long middle = first + (last - first) / 2;
+    return pairwiseBlockSum(job, first, middle) + pairwiseBlockSum(job, middle, last);
+}
+
+/*
+ * Сбор частичных сумм из слотов потоков.
+ * Вызывается главным потоком после завершения всех потоков.
+ * */
+double reduceThreadSlots(JobContext &job, int numberOfThreads) {
+    double sum = 0;
+    switch (job.reductionMode) {
+        case ReductionMode::Atomic:
+            sum = job.pi;
+            break;
+        case ReductionMode::Sequential:
+            for (int i = 0; i < numberOfThreads; i++)
+                sum += job.threadSlots[i]->partialPi;
+            break;
+        case ReductionMode::Pairwise:
+            sum = pairwiseSum(job.threadSlots, 0, numberOfThreads);
+            break;
+        case ReductionMode::Kahan: {
+            double compensation = 0;
+            for (int i = 0; i < numberOfThreads; i++) {
+                double term = job.threadSlots[i]->partialPi - compensation;
+                double next = sum + term;
+                compensation = (next - sum) - term;
+                sum = next;
+            }
+            break;
+        }
+        case ReductionMode::Deterministic:
+            sum = pairwiseBlockSum(job, 0, job.numberOfBlocks);
+            break;
+    }
+    return sum;
+}
+
+/*
+ * Подбор размера блока.
+ * Стоимость итерации измеряется один раз для каждого ядра на пробном диапазоне.
+ * Размер блока выбирается так, чтобы на каждый поток приходилось
+ * около BLOCKS_PER_THREAD блоков (для балансировки нагрузки),
+ * но блок считался не быстрее MIN_BLOCK_TIME мс -
+ * иначе накладные расходы на получение блока станут заметны.
+ * В режиме Guided это минимальный размер блока.
+ * */
+long long tuneBlockSize(JobContext &job, int numberOfThreads) {
+    const long long BLOCKS_PER_THREAD = 16;
+    const double MIN_BLOCK_TIME = 0.1;
+    const long long SAMPLE_ITERATIONS = 1 << 20;
+
+    // Стоимость итерации у ядер разная, поэтому она запоминается для каждого ядра
+    static std::map<Kernel, double> iterationTimes;
+    static std::mutex iterationTimesMutex;
+    std::lock_guard<std::mutex> lock(iterationTimesMutex);
+    double &iterationTime = iterationTimes[job.kernel.function];
+    if (iterationTime == 0) {
+        auto start = std::chrono::steady_clock::now();
+        volatile double sample = job.kernel.function(0, SAMPLE_ITERATIONS, SAMPLE_ITERATIONS);
+        (void) sample;
+        iterationTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+                        / SAMPLE_ITERATIONS;
+    }
+
+    long long minimalBlock = std::max(1LL, (long long) (MIN_BLOCK_TIME / iterationTime));
+    if (job.schedulingMode == SchedulingMode::Guided)
+        return minimalBlock;
+
+    long long balancedBlock = (job.rangeEnd - job.rangeStart) / (numberOfThreads * BLOCKS_PER_THREAD);
+    return std::max(minimalBlock, balancedBlock);
+}
+
+/*
+ * Главный поток прогрессивного расчета: собирает готовые блоки в оценку,
+ * передает ее progressCallback после каждого блока и решает, когда остановиться.
+ * Готовые блоки ищутся среди позиций [frontier, nextBlock) порядка обхода:
+ * все позиции до frontier уже учтены, поэтому просмотр после каждого
+ * сообщения стоит порядка числа потоков.
+ * */
+void followProgress(JobContext &job, std::chrono::high_resolution_clock::time_point start) {
+    job.progressiveEstimate.reset(job.numberOfIterations, job.blockSize);
+    std::vector<bool> counted(job.numberOfBlocks, false);
+    long long frontier = 0;
+
+    for (;;) {
+        {
+            TRACE_SCOPE(TraceEvent::Wait, 0);
+            waitForBlockDone(job.workers);
+        }
+        TRACE_SCOPE(TraceEvent::Progress, frontier);
+        bool allFinished = job.finishedWorkers.load(std::memory_order_acquire) == job.numberOfWorkers;
+
+        long long claimed = std::min(job.nextBlock.load(std::memory_order_relaxed), job.numberOfBlocks);
+        for (long long position = frontier; position < claimed; position++) {
+            if (counted[position])
+                continue;
+            double sum = job.blockSums[position].load(std::memory_order_acquire);
+            if (std::isnan(sum))
+                continue;
+            counted[position] = true;
+            job.progressiveEstimate.addBlock(job.blockOrder[position], sum);
+
+            double errorBound = job.kernel.normalize(job.progressiveEstimate.errorBound(), job.numberOfIterations);
+            if (job.progressCallback) {
+                double elapsed = std::chrono::duration<double, std::milli>(
+                        std::chrono::high_resolution_clock::now() - start).count();
+                job.progressCallback({elapsed, job.progressiveEstimate.completedBlocks(), job.numberOfBlocks,
+                                      job.kernel.normalize(job.progressiveEstimate.sum(), job.numberOfIterations),
+                                      errorBound});
+            }
+
+            if (job.targetError > 0 && errorBound <= job.targetError)
+                job.stopRequested = true;
+        }
+        while (frontier < claimed && counted[frontier])
+            frontier++;
+
+        if (job.timeBudget > 0 && std::chrono::steady_clock::now() >= job.deadline)
+            job.stopRequested = true;
+        if (allFinished)
+            break;
+    }
+}
+
+/*
+ * Процессоры, к которым привязаны потоки выполняемых расчетов.
+ * Одновременные задания из jobs.h с привязкой размещаются
+ * на еще не занятых процессорах, а не на одних и тех же.
+ * */
+static std::vector<LogicalProcessor> reservedProcessors;
+static std::mutex reservedProcessorsMutex;
+
+static bool sameProcessor(const LogicalProcessor &a, const LogicalProcessor &b) {
+    return a.group == b.group && a.number == b.number;
+}
+
+/*
+ * Размещение потоков расчета по политике на свободных процессорах.
+ * Если свободных меньше, чем потоков, размещение идет по всем процессорам.
+ * */
+std::vector<LogicalProcessor> reserveProcessors(AffinityPolicy policy, int numberOfThreads) {
+    // Топология не меняется между расчетами, читаем ее один раз.
+    static const std::vector<LogicalProcessor> topology = processorTopology();
+    std::lock_guard<std::mutex> lock(reservedProcessorsMutex);
+    std::vector<LogicalProcessor> available;
+    for (const LogicalProcessor &processor : topology) {
+        if (std::none_of(reservedProcessors.begin(), reservedProcessors.end(),
+                         [&](const LogicalProcessor &reserved) { return sameProcessor(reserved, processor); }))
+            available.push_back(processor);
+    }
+    std::vector<LogicalProcessor> placement =
+            placeWorkers(policy, (int) available.size() < numberOfThreads ? topology : available, numberOfThreads);
+    reservedProcessors.insert(reservedProcessors.end(), placement.begin(), placement.end());
+    return placement;
+}
+
+void releaseProcessors(const std::vector<LogicalProcessor> &placement) {
+    std::lock_guard<std::mutex> lock(reservedProcessorsMutex);
+    for (const LogicalProcessor &processor : placement) {
+        auto reserved = std::find_if(reservedProcessors.begin(), reservedProcessors.end(),
+                                     [&](const LogicalProcessor &other) { return sameProcessor(other, processor); });
+        if (reserved != reservedProcessors.end())
+            reservedProcessors.erase(reserved);
+    }
+}
+
+/*
+ * Расчет итераций [first, last) на numberOfThreads потоках.
+ * Результат нормируется как для всех numberOfIterations итераций,
+ * т.е. суммы по непересекающимся диапазонам складываются.
+ * */
+CalculationResult calculateIterations(JobContext &job, int numberOfThreads, long long first, long long last) {
+    if (job.schedulingMode == SchedulingMode::ParallelAlgorithm) {
+        auto start = std::chrono::high_resolution_clock::now();
+        double sum = 0;
+        parallelAlgorithmSum(job.parallelIntegrand, first, last, job.numberOfIterations, sum);
+        double time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start)
+                .count();
+        double value = job.kernel.normalize(sum, job.numberOfIterations);
+        return {value, time, 0, {}, {}, {}, {}, last - first, {}, false, 1, 0, sum, 1};
+    }
+
+    job.pi = 0;
+    // Поток ускорителя (если есть) идет последним, после потоков процессора
+    job.offloadWorker = job.offload ? numberOfThreads : -1;
+    job.numberOfWorkers = numberOfThreads + (job.offload ? 1 : 0);
+    job.rangeStart = first;
+    job.rangeEnd = last;
+    if (job.autoBlockSize)
+        job.blockSize = tuneBlockSize(job, numberOfThreads);
+    long long rangeLength = job.rangeEnd - job.rangeStart;
+    job.numberOfBlocks = rangeLength / job.blockSize + (rangeLength % job.blockSize ? 1 : 0);
+    job.blockKernel = job.specializeKernels
+                      ? specializeKernel(job.kernel.function, job.numberOfIterations, job.blockSize)
+                      : job.kernel.function;
+
+    job.threadSlots = new ThreadSlot *[job.numberOfWorkers]();
+    // Нули - суммы блоков, не обсчитанных из-за отмены
+    job.blockPartials = job.reductionMode == ReductionMode::Deterministic ? new double[job.numberOfBlocks]() : nullptr;
+
+    // Для прогрессивного расчета - порядок обхода блоков и их суммы (NaN - блок еще не обсчитан)
+    job.blockSums = nullptr;
+    if (job.progressive()) {
+        job.blockOrder = bisectionOrder(job.numberOfBlocks);
+        job.blockSums = new std::atomic<double>[job.numberOfBlocks];
+        for (long long i = 0; i < job.numberOfBlocks; i++)
+            job.blockSums[i].store(std::numeric_limits<double>::quiet_NaN(), std::memory_order_relaxed);
+        job.finishedWorkers = 0;
+        job.stopRequested = false;
+    }
+
+    /*
+     * Для режима WorkStealing раскладываем блоки по декам:
+     * потоку i достаются подряд идущие блоки
+     * [i * numberOfBlocks / numberOfThreads, (i + 1) * numberOfBlocks / numberOfThreads).
+     * Блоки кладутся в обратном порядке, чтобы владелец забирал их
+     * с "низа" дека по возрастанию номера, а "воры" - с конца диапазона.
+     * */
+    job.deques = nullptr;
+    if (job.schedulingMode == SchedulingMode::WorkStealing) {
+        job.deques = new WorkStealingDeque[numberOfThreads];
+        for (int i = 0; i < numberOfThreads; i++) {
+            long long firstBlock = job.numberOfBlocks * i / numberOfThreads;
+            long long lastBlock = job.numberOfBlocks * (i + 1) / numberOfThreads;
+            job.deques[i].reset(lastBlock - firstBlock);
+            for (long long block = lastBlock - 1; block >= firstBlock; block--)
+                job.deques[i].push(block);
+        }
+    }
+
+    /*
+     * Готовим потоки (при постоянном пуле создаются только недостающие).
+     * Потоки не начинают расчет до startWorkers.
+     * При этом каждый поток получает свой номер.
+     * С помощью этого каждый поток получает
+     * "отправную" точку для начала расчета (первый блок).
+     * */
+    auto setupStart = std::chrono::steady_clock::now();
+    std::vector<LogicalProcessor> placement;
+    if (job.affinityPolicy != AffinityPolicy::None)
+        placement = reserveProcessors(job.affinityPolicy, numberOfThreads);
+    if (job.hybridScheduling)
+        calibrateClasses(job, placement);
+
+    traceReset(job.numberOfWorkers);
+    job.workers = createWorkers(job.numberOfWorkers, calculateIteration, &job);
+
+    // Привязываем потоки к процессорам до их запуска.
+    std::vector<int> failedPins;
+    for (size_t i = 0; i < placement.size(); i++) {
+        if (!pinWorker(job.workers, (int) i, placement[i]))
+            failedPins.push_back((int) i);
+    }
+    if (job.hybridScheduling)
+        assignThreadWeights(job, placement);
+    double setupTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - setupStart).count();
+
+    /*
+     * nextBlock - общий счетчик блоков задания.
+     * Так как выше каждый поток получил по блоку,
+     * то nextBlock = число потоков.
+     * */
+    job.nextBlock = job.progressive() ? 0 : job.numberOfWorkers;
+    job.nextIteration = job.rangeStart;
+
+    // Начинаем замерять время выполнения.
+    auto start = std::chrono::high_resolution_clock::now();
+    job.deadline = std::chrono::steady_clock::now()
+                   + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                           std::chrono::duration<double, std::milli>(job.timeBudget));
+
+    // Возобновляем выполнение всех потоков.
+    startWorkers(job.workers);
+
+    if (job.progressive())
+        followProgress(job, start);
+
+    /*
+     * nextBlock атомарно инкрементируется в потоках
+     * после завершения обсчета очередного блока.
+     * Атомарность позволяет обеспечить безопасный доступ
+     * к переменной из нескольких потоков:
+     *      1) Так как атомарная операция неделима, вторая атомарная
+     *      операция над одним и тем же объектом из другого потока
+     *      может получить состояние объекта только до или после
+     *      первой атомарной операции.
+     *      2) На основе своего аргумента memory_order атомарная
+     *      операция устанавливает требования упорядоченности для
+     *      видимости влияния других атомарных операций в том же потоке.
+     *      Следовательно, она подавляет оптимизации компилятора,
+     *      которые нарушают требования к упорядоченности.
+     * (source: https://docs.microsoft.com/ru-ru/cpp/standard-library/atomic?view=msvc-160)
+     * В этой работе атомарные операции используются для инкремента
+     * счетчика подсчета блоков nextBlock и для "сбора" результата вычислений из блоков
+     * в переменную pi (обе операции производятся в потоках).
+     * */
+
+    /*
+     * Начинаем считать.
+     * В режиме SelfScheduling главный поток в распределении блоков
+     * не участвует - потоки сами забирают блоки, поэтому сразу
+     * переходим к ожиданию их завершения.
+     * */
+    while (!job.progressive() && job.schedulingMode == SchedulingMode::Handshake && job.nextBlock <= job.numberOfBlocks
+           && !job.cancelRequested()) {
+        /*
+         * Ждем первого сообщения от потоков.
+         * Т.е. поток по окончании расчета очередного блока сообщит
+         * свой номер и приостановится.
+         * */
+        int suspendedThreadIndex;
+        {
+            TRACE_SCOPE(TraceEvent::Wait, 0);
+            suspendedThreadIndex = waitForBlockDone(job.workers);
+        }
+
+        // Возобновляем выполнение потока (он уже получил следующий блок)
+        TRACE_SCOPE(TraceEvent::Resume, suspendedThreadIndex);
+        resumeWorker(job.workers, suspendedThreadIndex);
+    }
+
+    /*
+     * Все блоки обсчитаны, нужно собрать результат.
+     * (в остальных режимах потоки не приостанавливаются,
+     * и возобновлять их не нужно)
+     * */
+    for (int i = 0; !job.progressive() && job.schedulingMode == SchedulingMode::Handshake && i < numberOfThreads; i++){
+        /*
+         * Для этого возобновляем все потоки, чтобы
+         * после основного цикла все потоки сложили свои результаты
+         * в переменную pi задания.
+         * */
+        resumeWorker(job.workers, i);
+    }
+
+    // Ждем пока все потоки не завершат своё выполнение.
+    {
+        TRACE_SCOPE(TraceEvent::Join, 0);
+        joinWorkers(job.workers);
+        job.workers = nullptr;
+    }
+    releaseProcessors(placement);
+
+    /*
+     * Досчитываем Пи.
+     * Если прогрессивный расчет остановлен досрочно, результат - оценка
+     * по готовым блокам.
+     * */
+    auto reductionStart = std::chrono::steady_clock::now();
+    double sum = reduceThreadSlots(job, job.numberOfWorkers);
+    double reductionTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - reductionStart)
+            .count();
+    if (!placement.empty())
+        measureClassThroughput(job, placement);
+    job.pi = job.kernel.normalize(sum, job.numberOfIterations);
+    long long completedBlocks = job.numberOfBlocks;
+    double errorEstimate = 0;
+    if (job.progressive()) {
+        completedBlocks = job.progressiveEstimate.completedBlocks();
+        if (completedBlocks < job.numberOfBlocks) {
+            job.pi = job.kernel.normalize(job.progressiveEstimate.sum(), job.numberOfIterations);
+            errorEstimate = job.kernel.normalize(job.progressiveEstimate.errorBound(), job.numberOfIterations);
+        }
+    }
+
+    // Заканчиванием замерять время выполнения.
+    auto end = std::chrono::high_resolution_clock::now();
+    // Подсчитываем затраченное время.
+    double time = std::chrono::duration<double, std::milli>(end - start).count();
+
+    CalculationResult result = {job.pi, time, setupTime, {}, {}, {}, {}, job.blockSize, placement,
+                                job.blockKernel != job.kernel.function, completedBlocks, errorEstimate, sum,
+                                job.numberOfBlocks};
+    result.reductionTime = reductionTime;
+    result.failedPins = failedPins;
+    long long computedIterations = 0;
+    for (int i = 0; i < job.numberOfWorkers; i++) {
+        result.busyTime.push_back(job.threadSlots[i]->busyTime);
+        result.blocks.push_back(job.threadSlots[i]->blocks);
+        result.steals.push_back(job.threadSlots[i]->steals);
+        result.failedSteals.push_back(job.threadSlots[i]->failedSteals);
+        result.iterations.push_back(job.threadSlots[i]->iterations);
+        computedIterations += job.threadSlots[i]->iterations;
+        if (job.collectCounters)
+            result.counters.push_back(job.threadSlots[i]->counters);
+        releaseSlot(job.threadSlots[i]);
+    }
+
+    // Отмена, пришедшая после последнего блока, результат не меняет
+    result.cancelled = job.cancelRequested() && computedIterations < rangeLength;
+
+    delete[] job.threadSlots;
+    delete[] job.deques;
+    delete[] job.blockSums;
+    delete[] job.blockPartials;
+
+    return result;
+}
+
+bool prepareJob(const JobConfig &config, KernelInfo &kernel, double &exactValue) {
+    if (config.threads < 1) {
+        std::cerr << "Number of threads should be positive" << std::endl;
+        return false;
+    }
+    if (config.iterations < 1 || config.blockSize < 1) {
+        std::cerr << "Number of iterations and block size should be positive" << std::endl;
+        return false;
+    }
+    long long last = config.last ? config.last : config.iterations;
+    if (config.first < 0 || config.first >= last || last > config.iterations) {
+        std::cerr << "Iteration range should be a non-empty part of [0, iterations)" << std::endl;
+        return false;
+    }
+    if (config.accumulation != Accumulation::Plain && config.precision == Precision::Reference) {
+        std::cerr << "Accumulation modes are implemented for -p exact and -p fast kernels" << std::endl;
+        return false;
+    }
+    if (!findKernel(config.kernel, config.precision, kernel, config.accumulation)) {
+        // Ядро есть, но без накопления повышенной точности (у скалярного ядра оно есть всегда, кроме fixed128)
+        KernelInfo otherKernel;
+        if (findKernel(config.kernel, config.precision, otherKernel)
+            && findKernel("scalar", config.precision, otherKernel, config.accumulation)) {
+            std::cerr << "Kernel " << config.kernel << " has no accumulation modes" << std::endl;
+            return false;
+        }
+        if (config.accumulation == Accumulation::Fixed128) {
+            std::cerr << "Fixed-point accumulation needs a compiler with 128-bit integers" << std::endl;
+            return false;
+        }
+        std::cerr << "Kernel " << config.kernel << " is unknown or not supported by this CPU" << std::endl;
+        return false;
+    }
+    exactValue = PiIntegrand::exact();
+    if (config.genericIntegrand() && !findIntegrand(config.integrand, config.rule, kernel, exactValue)) {
+        std::cerr << "Unknown integrand " << config.integrand << std::endl;
+        return false;
+    }
+    if (config.mode == SchedulingMode::ParallelAlgorithm
+        && (config.rule != QuadratureRule::Midpoint || config.progressive())) {
+        std::cerr << "pstl mode supports the midpoint rule without time budget or target error" << std::endl;
+        return false;
+    }
+    // Прогрессивный расчет сам раздает блоки в порядке bisectionOrder, разбиение других режимов не используется
+    if (config.progressive() && config.mode != SchedulingMode::SelfScheduling) {
+        std::cerr << "Time budget and target error are supported in self mode only" << std::endl;
+        return false;
+    }
+    if (config.offloadBlocks) {
+        if (!offloadSupported()) {
+            std::cerr << "Offload is not available: build with -DENABLE_OFFLOAD=ON" << std::endl;
+            return false;
+        }
+        if (config.mode != SchedulingMode::SelfScheduling || config.progressive() || config.genericIntegrand()
+            || config.offloadBlocks < 0) {
+            std::cerr << "Offload supports the pi integrand in self mode without time budget or target error,"
+                      << " with a positive number of blocks per launch" << std::endl;
+            return false;
+        }
+    }
+    if (config.hybrid && (config.affinity == AffinityPolicy::None || config.offloadBlocks
+                          || (config.mode != SchedulingMode::SelfScheduling && config.mode != SchedulingMode::Guided)
+                          || config.progressive())) {
+        std::cerr << "Hybrid scheduling needs pinned threads (-a) in self or guided mode without offload,"
+                  << " time budget or target error" << std::endl;
+        return false;
+    }
+    /*
+     * Детерминированная редукция требует, чтобы разбиение на блоки
+     * зависело только от N и размера блока.
+     * */
+    if (config.reduction == ReductionMode::Deterministic
+        && ((config.mode != SchedulingMode::Handshake && config.mode != SchedulingMode::SelfScheduling
+             && config.mode != SchedulingMode::WorkStealing)
+            || config.hybrid || config.offloadBlocks || config.progressive() || config.autoBlockSize)) {
+        std::cerr << "Deterministic reduction needs fixed blocks: handshake, self or stealing mode"
+                  << " with an explicit block size, without hybrid, offload or progressive options" << std::endl;
+        return false;
+    }
+    if (!(config.dutyCycle > 0 && config.dutyCycle <= 1)) {
+        std::cerr << "Duty cycle should be in (0, 1]" << std::endl;
+        return false;
+    }
+    if (config.mode == SchedulingMode::ParallelAlgorithm && (config.dutyCycle < 1 || config.idlePriority)) {
+        std::cerr << "pstl mode runs on library threads, duty cycle and idle priority do not apply" << std::endl;
+        return false;
+    }
+    // Поток ускорителя не делает пауз, и его блоки не ограничивались бы
+    if (config.offloadBlocks && config.dutyCycle < 1) {
+        std::cerr << "Duty cycle does not apply to offloaded blocks, run without --offload" << std::endl;
+        return false;
+    }
+    // Подобранный размер блока зависит от замеров, и суммы с ним нельзя сопоставить ключу кэша
+    if (!config.cacheFile.empty() && (config.progressive() || config.first || config.last || config.autoBlockSize)) {
+        std::cerr << "Result cache applies to whole-range runs with an explicit block size,"
+                  << " without time budget or target error" << std::endl;
+        return false;
+    }
+    // Формула Симпсона обходит отрезки парами
+    if (config.rule == QuadratureRule::Simpson && config.iterations % 2) {
+        std::cerr << "Simpson rule needs an even number of iterations" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+CalculationResult runJob(const JobConfig &config, const std::atomic<bool> &cancelled) {
+    // Состояние расчета - свое у каждого вызова, см. JobContext
+    JobContext job;
+    // Параметры уже проверены, здесь выбирается то же ядро
+    prepareJob(config, job.kernel, job.exactValue);
+    job.numberOfIterations = config.iterations;
+    job.blockSize = config.blockSize;
+    job.autoBlockSize = config.autoBlockSize;
+    job.schedulingMode = config.mode;
+    job.reductionMode = config.reduction;
+    job.specializeKernels = config.specializeKernels;
+    job.parallelIntegrand = config.integrand;
+    job.affinityPolicy = config.affinity;
+    job.timeBudget = config.timeBudget;
+    job.targetError = config.targetError;
+    job.progressCallback = config.progress;
+    job.offload = config.offloadBlocks > 0;
+    job.offloadBlocks = config.offloadBlocks;
+    job.hybridScheduling = config.hybrid;
+    job.collectCounters = config.counters;
+    job.dutyCycle = config.dutyCycle;
+    job.idlePriority = config.idlePriority;
+    job.priorityFailed = false;
+    job.cancelToken = &cancelled;
+
+    std::vector<long long> energyBefore;
+    if (config.measureEnergy)
+        energyBefore = readPackageEnergy();
+    CalculationResult result = calculateIterations(job, config.threads, config.first,
+                                                   config.last ? config.last : config.iterations);
+    result.energy = config.measureEnergy ? consumedEnergy(energyBefore, readPackageEnergy()) : -1;
+    result.priorityFailed = job.priorityFailed;
+    result.kernel = job.kernel.name;
+    result.exactValue = job.exactValue;
+    return result;
+}
+
+double loadImbalance(const CalculationResult &result) {
+    double maxBusy = 0, totalBusy = 0;
+    for (double busy : result.busyTime) {
+        maxBusy = std::max(maxBusy, busy);
+        totalBusy += busy;
+    }
+    return totalBusy > 0 ? maxBusy * result.busyTime.size() / totalBusy : 1;
+}
+
+const char *schedulingModeName(SchedulingMode mode) {
+    switch (mode) {
+        case SchedulingMode::Handshake:
+            return "handshake";
+        case SchedulingMode::SelfScheduling:
+            return "self";
+        case SchedulingMode::Guided:
+            return "guided";
+        case SchedulingMode::WorkStealing:
+            return "stealing";
+        case SchedulingMode::ParallelAlgorithm:
+            return "pstl";
+    }
+    return "";
+}
+
+const char *threadingBackendName(SchedulingMode mode) {
+    return mode == SchedulingMode::ParallelAlgorithm ? parallelAlgorithmName() : backendName();
+}
+
+const char *reductionModeName(ReductionMode mode) {
+    switch (mode) {
+        case ReductionMode::Atomic:
+            return "atomic";
+        case ReductionMode::Sequential:
+            return "sequential";
+        case ReductionMode::Pairwise:
+            return "pairwise";
+        case ReductionMode::Kahan:
+            return "kahan";
+        case ReductionMode::Deterministic:
+            return "deterministic";
+    }
+    return "";
+}
+
@@ -0,0 +1,235 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+/*
+ * Движок расчета: пул потоков, планирование блоков и сбор результата.
+ * Параметры расчета передаются в JobConfig, результат - в CalculationResult.
+ * runJob выполняет расчет в вызывающем потоке на потоках общего пула;
+ * состояние расчета у каждого вызова свое, поэтому задания из разных
+ * потоков могут выполняться одновременно (их раздает очередь из jobs.h).
+ * */
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "affinity.h"
+#include "backend.h"
+#include "integrands.h"
+#include "kernels.h"
+#include "perfcounters.h"
+
+/*
+ * Режим планирования блоков:
+ *      Handshake - после каждого блока поток сообщает главному потоку
+ *      свой номер (порт завершения Win32 или очередь бэкенда STD) и ждет
+ *      разрешения продолжить, а главный поток получает номер и выдает
+ *      потоку разрешение (исходная схема по заданию, см. notifyBlockDone);
+ *      SelfScheduling - потоки сами забирают следующий блок из nextBlock
+ *      и не приостанавливаются, главный поток только дожидается
+ *      завершения всех потоков;
+ *      WorkStealing - блоки заранее поровну раскладываются по декам потоков
+ *      (см. workstealing.h); поток обсчитывает блоки своего дека, а когда
+ *      он опустеет, захватывает блоки из деков других потоков.
+ *      Общего счетчика nextBlock, за кэш-линию которого соревнуются
+ *      все потоки, в этом режиме нет;
+ *      Guided - как SelfScheduling, но размер очередного блока уменьшается
+ *      по мере убывания оставшейся работы (остаток / число потоков,
+ *      но не меньше blockSize), как schedule(guided) в OpenMP.
+ *      Так длинный "хвост" в конце расчета не достается одному потоку;
+ *      ParallelAlgorithm - без собственных потоков и блоков:
+ *      std::transform_reduce(par_unseq) по итерациям (см. parallelalgorithm.h),
+ *      для сравнения с остальными режимами.
+ * */
+enum class SchedulingMode {
+    Handshake,
+    SelfScheduling,
+    Guided,
+    WorkStealing,
+    ParallelAlgorithm
+};
+
+/*
+ * Способ сбора частичных сумм потоков в итоговое Пи:
+ *      Atomic - каждый поток сам прибавляет свою сумму к std::atomic<double> pi
+ *      (исходная схема; в MSVC это цикл compare-and-swap);
+ *      Sequential, Pairwise, Kahan - каждый поток записывает сумму в свой слот
+ *      threadSlots, а главный поток после завершения потоков складывает слоты
+ *      по порядку, попарно (дерево) или с компенсацией погрешности (Кэхэн).
+ *      Порядок сложения при этом не зависит от того, какой поток закончил первым;
+ *      Deterministic - сумма каждого блока записывается по номеру блока,
+ *      и суммы блоков складываются попарно (дерево по номерам блоков).
+ *      Результат не зависит ни от числа потоков, ни от того, какие блоки
+ *      достались каким потокам (при одних N и размере блока он побитово одинаков).
+ *      Только для режимов с блоками фиксированного размера (handshake, self, stealing).
+ * */
+enum class ReductionMode {
+    Atomic,
+    Sequential,
+    Pairwise,
+    Kahan,
+    Deterministic
+};
+
+// Результат одного расчета
+struct CalculationResult {
+    double pi;
+    // Затраченное время, мс
+    double time;
+    // Время подготовки потоков (создание и привязка к процессорам), мс
+    double setupTime;
+    // Время расчета блоков каждым потоком, мс
+    std::vector<double> busyTime;
+    // Число блоков, обсчитанных каждым потоком
+    std::vector<long long> blocks;
+    // Число удачных и неудачных попыток захвата блоков каждым потоком
+    std::vector<long long> steals;
+    std::vector<long long> failedSteals;
+    // Размер блока, с которым проводился расчет
+    long long blockSize;
+    // Логические процессоры, к которым были привязаны потоки (пусто - без привязки)
+    std::vector<LogicalProcessor> placement;
+    // Считалось ли ядром, специализированным под N и размер блока
+    bool specialized;
+    // Число обсчитанных блоков и оценка погрешности (в прогрессивном режиме)
+    long long completedBlocks;
+    double errorEstimate;
+    // Сумма ядра по диапазону до нормировки (складывается между узлами)
+    double sum;
+    // Число блоков расчета, ядро и точное значение интеграла (для оценки погрешности)
+    long long numberOfBlocks;
+    const char *kernel = "";
+    double exactValue = 0;
+    // Из-за отмены часть итераций не обсчитана (отмена после последнего блока не считается)
+    bool cancelled = false;
+    // Число итераций, обсчитанных каждым потоком
+    std::vector<long long> iterations = {};
+    // Время сбора частичных сумм главным потоком, мс
+    double reductionTime = 0;
+    // Итерации, суммы по которым взяты из кэша результатов (см. resultcache.h)
+    long long cachedIterations = 0;
+    // Счетчики процессора каждого потока (пусто, если JobConfig::counters не задан)
+    std::vector<PerfCounters> counters = {};
+    // Энергия пакетов процессора за расчет, Дж (-1 - не измерялась или RAPL недоступен)
+    double energy = -1;
+    // Номера потоков, которые не удалось привязать к процессорам placement
+    std::vector<int> failedPins = {};
+    // Хотя бы одному потоку не удалось сменить приоритет (JobConfig::idlePriority)
+    bool priorityFailed = false;
+};
+
+// Промежуточная оценка прогрессивного расчета (см. JobConfig::progress)
+struct ProgressReport {
+    // Время с начала расчета, мс
+    double elapsed;
+    long long completedBlocks;
+    long long numberOfBlocks;
+    // Оценка интеграла по готовым блокам и ее погрешность (нормированные)
+    double estimate;
+    double errorBound;
+};
+
+typedef void (*ProgressCallback)(const ProgressReport &report);
+
+// Параметры одного расчета
+struct JobConfig {
+    int threads = 1;
+    // Точность - 100000000 по заданию (количество итераций)
+    long long iterations = 100000000;
+    // Размер блока - 10*номерСтудБилета = 830704*10 = 8307040
+    long long blockSize = 8307040;
+    // Подбор размера блока перед расчетом (см. tuneBlockSize)
+    bool autoBlockSize = false;
+    SchedulingMode mode = SchedulingMode::SelfScheduling;
+    ReductionMode reduction = ReductionMode::Pairwise;
+    // Набор инструкций ядра (auto, scalar, sse2, avx2, avx512), точность и накопление (см. kernels.h)
+    std::string kernel = "auto";
+    Precision precision = Precision::Reference;
+    Accumulation accumulation = Accumulation::Plain;
+    // Ядра, скомпилированные под конкретные N и размер блока (см. specializeKernel)
+    bool specializeKernels = true;
+    /*
+     * Подынтегральная функция (pi, sin, gauss) и квадратурная формула.
+     * pi со средними точками считается ядрами из kernels.h,
+     * остальные сочетания - обобщенными ядрами из integrands.h.
+     * */
+    std::string integrand = "pi";
+    QuadratureRule rule = QuadratureRule::Midpoint;
+    AffinityPolicy affinity = AffinityPolicy::None;
+    // Прогрессивный расчет (только режим self): бюджет времени, мс, и целевая погрешность (0 - не задано)
+    double timeBudget = 0;
+    double targetError = 0;
+    /*
+     * Вызывается в прогрессивном расчете после каждого учтенного блока
+     * потоком, выполняющим runJob (nullptr - без промежуточных оценок).
+     * */
+    ProgressCallback progress = nullptr;
+    // Блоков на один запуск на ускорителе (0 - без ускорителя, см. offload.h)
+    long long offloadBlocks = 0;
+    /*
+     * Учет гибридных процессоров: размер блока потока пропорционален
+     * измеренной пропускной способности класса его ядра (P/E).
+     * Только для привязанных потоков (affinity) и режимов self и guided.
+     * */
+    bool hybrid = false;
+    /*
+     * Обсчитываемые итерации [first, last) из iterations (last = 0 - до конца).
+     * Результат нормируется как для всех iterations итераций,
+     * т.е. суммы по непересекающимся диапазонам складываются.
+     * */
+    long long first = 0;
+    long long last = 0;
+    // Файл кэша результатов (пусто - без кэша, см. resultcache.h); задания из jobs.h
+    std::string cacheFile;
+    // Сбор счетчиков процессора по потокам (см. perfcounters.h)
+    bool counters = false;
+    /*
+     * Фоновый режим для общих машин (число потоков ограничивает threads):
+     * dutyCycle - доля времени, которую поток считает: после блока длительностью t
+     * поток спит t * (1 - dutyCycle) / dutyCycle (1 - без пауз);
+     * idlePriority - потоки с наименьшим приоритетом (см. setCurrentThreadIdlePriority),
+     * они не отнимают процессор у других программ.
+     * */
+    double dutyCycle = 1;
+    bool idlePriority = false;
+    // Замер энергии пакетов процессора за расчет (см. energy.h)
+    bool measureEnergy = false;
+
+    bool genericIntegrand() const {
+        return integrand != "pi" || rule != QuadratureRule::Midpoint;
+    }
+
+    bool progressive() const {
+        return timeBudget > 0 || targetError > 0;
+    }
+};
+
+/*
+ * Проверка параметров и выбор ядра расчета без изменения состояния движка.
+ * kernel - ядро (или обобщенное ядро функции), exactValue - точное значение интеграла.
+ * Возвращает false и выводит причину в std::cerr, если расчет с такими параметрами невозможен.
+ * */
+bool prepareJob(const JobConfig &config, KernelInfo &kernel, double &exactValue);
+
+/*
+ * Расчет по параметрам, уже проверенным prepareJob.
+ * cancelled опрашивается потоками между блоками: после отмены
+ * новые блоки не берутся, результат - сумма уже обсчитанных блоков
+ * (CalculationResult::cancelled = true, если какие-то блоки пропущены).
+ * Режим pstl cancelled не опрашивает: std::transform_reduce нельзя прервать.
+ * */
+CalculationResult runJob(const JobConfig &config, const std::atomic<bool> &cancelled);
+
+/*
+ * Дисбаланс нагрузки - отношение максимального времени расчета
+ * блоков потоком к среднему (1 - нагрузка распределена идеально).
+ * */
+double loadImbalance(const CalculationResult &result);
+
+const char *schedulingModeName(SchedulingMode mode);
+const char *reductionModeName(ReductionMode mode);
+
+// Бэкенд потоков; в режиме pstl потоки создает реализация стандартной библиотеки
+const char *threadingBackendName(SchedulingMode mode);
+
+#endif //ENGINE_H
@@ -0,0 +1,61 @@
+#include "integrands.h"
+
+bool parseQuadratureRule(const std::string &name, QuadratureRule &rule) {
+    if (name == "midpoint")
+        rule = QuadratureRule::Midpoint;
+    else if (name == "trapezoid")
+        rule = QuadratureRule::Trapezoid;
+    else if (name == "simpson")
+        rule = QuadratureRule::Simpson;
+    else
+        return false;
+    return true;
+}
+
+const char *quadratureRuleName(QuadratureRule rule) {
+    switch (rule) {
+        case QuadratureRule::Midpoint:
+            return "midpoint";
+        case QuadratureRule::Trapezoid:
+            return "trapezoid";
+        case QuadratureRule::Simpson:
+            return "simpson";
+    }
+    return "unknown";
+}
+
+// Ядро и нормировка для функции Integrand по формуле rule
+template<class Integrand>
+static KernelInfo integrandKernelInfo(const char *const names[3], QuadratureRule rule) {
+    switch (rule) {
+        case QuadratureRule::Midpoint:
+            return {names[0], integrandKernel<Integrand, QuadratureRule::Midpoint>,
+                    integrandNormalization<Integrand, QuadratureRule::Midpoint>};
+        case QuadratureRule::Trapezoid:
+            return {names[1], integrandKernel<Integrand, QuadratureRule::Trapezoid>,
+                    integrandNormalization<Integrand, QuadratureRule::Trapezoid>};
+        case QuadratureRule::Simpson:
+            return {names[2], integrandKernel<Integrand, QuadratureRule::Simpson>,
+                    integrandNormalization<Integrand, QuadratureRule::Simpson>};
+    }
+    return {};
+}
+
+bool findIntegrand(const std::string &name, QuadratureRule rule, KernelInfo &kernel, double &exactValue) {
+    if (name == "pi") {
+        static const char *const names[] = {"pi midpoint", "pi trapezoid", "pi Simpson"};
+        kernel = integrandKernelInfo<PiIntegrand>(names, rule);
+        exactValue = PiIntegrand::exact();
+    } else if (name == "sin") {
+        static const char *const names[] = {"sin midpoint", "sin trapezoid", "sin Simpson"};
+        kernel = integrandKernelInfo<SinIntegrand>(names, rule);
+        exactValue = SinIntegrand::exact();
+    } else if (name == "gauss") {
+        static const char *const names[] = {"gauss midpoint", "gauss trapezoid", "gauss Simpson"};
+        kernel = integrandKernelInfo<GaussIntegrand>(names, rule);
+        exactValue = GaussIntegrand::exact();
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,146 @@
+#ifndef INTEGRANDS_H
+#define INTEGRANDS_H
+
+#include <cmath>
+#include <string>
+
+#include "kernels.h"
+
+/*
+ * Обобщенные ядра: интегрирование произвольной функции одной переменной.
+ * Функция передается как тип-функтор параметром шаблона, поэтому
+ * integrandKernel<F, rule> - обычная функция с сигнатурой Kernel,
+ * в которую вызов F встраивается (inline) компилятором,
+ * и ее можно передавать в тот же механизм блоков и потоков.
+ * Функтор задает отрезок интегрирования (lower, upper),
+ * точное значение интеграла и саму функцию (operator()).
+ * */
+
+// Квадратурная формула
+enum class QuadratureRule {
+    // Средние точки: h * sum f(a + (i + 0.5) h)
+    Midpoint,
+    // Трапеции: h * (f(a) / 2 + f(a + h) + ... + f(b - h) + f(b) / 2)
+    Trapezoid,
+    // Симпсон: h / 3 * (f(a) + 4 f(a + h) + 2 f(a + 2h) + ... + 4 f(b - h) + f(b)), n четное
+    Simpson
+};
+
+// 4 / (1 + x^2) на [0, 1] = Пи
+struct PiIntegrand {
+    static constexpr double lower = 0;
+    static constexpr double upper = 1;
+
+    static double exact() {
+        return 3.141592653589793238462643383279502884;
+    }
+
+    double operator()(double x) const {
+        return 4 / (1 + x * x);
+    }
+};
+
+// sin(x) на [0, Пи] = 2
+struct SinIntegrand {
+    static constexpr double lower = 0;
+    static constexpr double upper = 3.141592653589793238462643383279502884;
+
+    static double exact() {
+        return 2;
+    }
+
+    double operator()(double x) const {
+        return std::sin(x);
+    }
+};
+
+// exp(-x^2) на [0, 1] = sqrt(Пи) / 2 * erf(1)
+struct GaussIntegrand {
+    static constexpr double lower = 0;
+    static constexpr double upper = 1;
+
+    static double exact() {
+        return std::sqrt(PiIntegrand::exact()) / 2 * std::erf(1.0);
+    }
+
+    double operator()(double x) const {
+        return std::exp(-x * x);
+    }
+};
+
+/*
+ * Вес узла i (0 < i < n) в формуле; узлы 0 и n учитываются отдельно.
+ * Для средних точек "узел" i - середина i-го отрезка.
+ * */
+template<QuadratureRule rule>
+inline double nodeWeight(long long i) {
+    if (rule == QuadratureRule::Simpson)
+        return i % 2 ? 4 : 2;
+    return 1;
+}
+
+/*
+ * Сумма взвешенных значений функции в узлах [start, end).
+ * Граничные узлы формул трапеций и Симпсона (0 и n) добавляются
+ * блоком, который их содержит: узел 0 - блоком с start = 0,
+ * узел n - блоком с end = n.
+ * Основной цикл развернут на четыре независимых аккумулятора,
+ * как в векторных ядрах (см. kernels.cpp); для Симпсона развертка
+ * начинается с нечетного узла, т.е. веса в ней всегда 4, 2, 4, 2.
+ * */
+template<class Integrand, QuadratureRule rule>
+double integrandKernel(long long start, long long end, long long n) {
+    const Integrand f;
+    const double h = (Integrand::upper - Integrand::lower) / n;
+    const double offset = rule == QuadratureRule::Midpoint ? 0.5 : 0;
+
+    double sum = 0;
+    long long i = start;
+
+    if (rule != QuadratureRule::Midpoint) {
+        if (i == 0 && i < end) {
+            sum += (rule == QuadratureRule::Simpson ? 1 : 0.5) * f(Integrand::lower);
+            i++;
+        }
+        if (end == n)
+            sum += (rule == QuadratureRule::Simpson ? 1 : 0.5) * f(Integrand::upper);
+    }
+    if (rule == QuadratureRule::Simpson && i % 2 == 0 && i < end) {
+        sum += 2 * f(Integrand::lower + i * h);
+        i++;
+    }
+
+    double sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+    double idx = i + offset;
+    for (; i + 4 <= end; i += 4, idx += 4) {
+        sum0 += nodeWeight<rule>(1) * f(Integrand::lower + idx * h);
+        sum1 += nodeWeight<rule>(2) * f(Integrand::lower + (idx + 1) * h);
+        sum2 += nodeWeight<rule>(1) * f(Integrand::lower + (idx + 2) * h);
+        sum3 += nodeWeight<rule>(2) * f(Integrand::lower + (idx + 3) * h);
+    }
+    for (; i < end; i++, idx += 1)
+        sum += nodeWeight<rule>(i) * f(Integrand::lower + idx * h);
+
+    return sum + ((sum0 + sum1) + (sum2 + sum3));
+}
+
+// Нормировка суммы integrandKernel: умножение на шаг (и 1/3 для Симпсона).
+template<class Integrand, QuadratureRule rule>
+double integrandNormalization(double sum, long long n) {
+    const double h = (Integrand::upper - Integrand::lower) / n;
+    return rule == QuadratureRule::Simpson ? sum * h / 3 : sum * h;
+}
+
+// Разбор названия формулы (midpoint, trapezoid, simpson).
+bool parseQuadratureRule(const std::string &name, QuadratureRule &rule);
+
+const char *quadratureRuleName(QuadratureRule rule);
+
+/*
+ * Ядро для функции name (pi, sin, gauss) и формулы rule,
+ * а также точное значение интеграла.
+ * Возвращает false, если функция неизвестна.
+ * */
+bool findIntegrand(const std::string &name, QuadratureRule rule, KernelInfo &kernel, double &exactValue);
+
+#endif //INTEGRANDS_H
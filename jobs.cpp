@@ -0,0 +1,159 @@
+#include "jobs.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "resultcache.h"
+#include "trace.h"
+
+/*
+ * Задание в очереди. Флаг отмены общий у очереди и движка:
+ * runJob опрашивает его между блоками.
+ * */
+struct QueuedJob {
+    long long id;
+    JobConfig config;
+    std::promise<CalculationResult> result;
+    std::shared_ptr<std::atomic<bool>> cancelled;
+};
+
+// Выполняемое задание: флаг отмены и занятые им процессоры
+struct RunningJob {
+    std::shared_ptr<std::atomic<bool>> cancelled;
+    int threads;
+    bool cached;
+};
+
+static std::mutex jobsMutex;
+static std::condition_variable jobsCondition;
+static std::deque<QueuedJob> queue;
+static std::map<long long, RunningJob> running;
+// Потоки выполняемых заданий и закончившие потоки, которые еще не присоединены
+static std::map<long long, std::thread> runners;
+static std::vector<std::thread> finishedRunners;
+// Процессоры, занятые выполняемыми заданиями
+static int busyThreads = 0;
+// Кэш результатов (resultcache.h) - один файл на процесс, задания с кэшем выполняются по одному
+static bool cachedRunning = false;
+static long long nextId = 1;
+static bool stopping = false;
+
+/*
+ * Процессоры, которые занимает задание: потоки пула и поток ускорителя.
+ * pstl считает на потоках библиотеки по всем процессорам.
+ * */
+static int jobThreads(const JobConfig &config) {
+    if (config.mode == SchedulingMode::ParallelAlgorithm)
+        return numberOfProcessors();
+    return config.threads + (config.offloadBlocks ? 1 : 0);
+}
+
+static void runQueuedJob(QueuedJob job);
+
+/*
+ * Запуск заданий из начала очереди (вызывается под jobsMutex).
+ * Задания запускаются в порядке постановки, пока их потоки помещаются
+ * на свободные процессоры; задание больше всей машины выполняется одно.
+ * С трассировкой задания выполняются по одному: буферы трассы общие (см. trace.h).
+ * */
+static void dispatchJobs() {
+    for (std::thread &runner : finishedRunners)
+        runner.join();
+    finishedRunners.clear();
+
+    while (!stopping && !queue.empty()) {
+        const JobConfig &config = queue.front().config;
+        int threads = jobThreads(config);
+        bool cached = !config.cacheFile.empty();
+        if (!running.empty() && (busyThreads + threads > numberOfProcessors() || tracingEnabled()
+                                 || (cached && cachedRunning)))
+            return;
+
+        QueuedJob job = std::move(queue.front());
+        queue.pop_front();
+        long long id = job.id;
+        running[id] = {job.cancelled, threads, cached};
+        busyThreads += threads;
+        cachedRunning = cachedRunning || cached;
+        runners[id] = std::thread(runQueuedJob, std::move(job));
+    }
+}
+
+// Поток задания: расчет, затем освобождение процессоров и запуск следующих заданий
+static void runQueuedJob(QueuedJob job) {
+    // Исключение расчета (например, std::bad_alloc) передается в future, а процессоры все равно освобождаются
+    try {
+        job.result.set_value(job.config.cacheFile.empty() ? runJob(job.config, *job.cancelled)
+                                                          : runCachedJob(job.config, *job.cancelled));
+    } catch (...) {
+        job.result.set_exception(std::current_exception());
+    }
+
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    const RunningJob &finished = running[job.id];
+    busyThreads -= finished.threads;
+    if (finished.cached)
+        cachedRunning = false;
+    running.erase(job.id);
+    dispatchJobs();
+    // Свой поток присоединить нельзя, его присоединит следующий вызов dispatchJobs или shutdownJobs
+    finishedRunners.push_back(std::move(runners[job.id]));
+    runners.erase(job.id);
+    jobsCondition.notify_all();
+}
+
+bool submitJob(const JobConfig &config, JobTicket &ticket) {
+    KernelInfo kernel;
+    double exactValue;
+    if (!prepareJob(config, kernel, exactValue))
+        return false;
+
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    QueuedJob job = {nextId++, config, {}, std::make_shared<std::atomic<bool>>(false)};
+    ticket.id = job.id;
+    ticket.result = job.result.get_future();
+    queue.push_back(std::move(job));
+    dispatchJobs();
+    return true;
+}
+
+bool cancelJob(long long id) {
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    auto runningJob = running.find(id);
+    if (runningJob != running.end()) {
+        runningJob->second.cancelled->store(true, std::memory_order_relaxed);
+        return true;
+    }
+    for (auto job = queue.begin(); job != queue.end(); ++job) {
+        if (job->id == id) {
+            // Удаленный promise отдает future исключение broken_promise
+            queue.erase(job);
+            return true;
+        }
+    }
+    return false;
+}
+
+void shutdownJobs() {
+    {
+        std::unique_lock<std::mutex> lock(jobsMutex);
+        stopping = true;
+        queue.clear();
+        for (const auto &job : running)
+            job.second.cancelled->store(true, std::memory_order_relaxed);
+        jobsCondition.wait(lock, [] { return running.empty(); });
+        for (std::thread &runner : finishedRunners)
+            runner.join();
+        finishedRunners.clear();
+        stopping = false;
+    }
+
+    closeResultCache();
+    shutdownWorkers();
+}
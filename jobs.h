@@ -0,0 +1,51 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+/*
+ * Асинхронный интерфейс движка для встраивания в другие программы.
+ * submitJob ставит расчет в очередь и сразу возвращает std::future с результатом.
+ * Задания выполняются на общем пуле потоков (см. backend.h): каждое задание
+ * занимает столько потоков пула, сколько указано в его JobConfig, а пул
+ * переживает задания. Задания из начала очереди запускаются одновременно,
+ * пока их потоки помещаются на свободные процессоры (numberOfProcessors);
+ * следующее задание ждет, пока выполняемые не освободят процессоры.
+ * Потоки одновременных заданий с привязкой (JobConfig::affinity) размещаются
+ * на разных процессорах: расчет занимает их до своего завершения.
+ * submitJob и cancelJob можно вызывать из любых потоков одновременно.
+ * */
+
+#include <future>
+
+#include "engine.h"
+
+// Поставленное задание: номер для отмены и будущий результат
+struct JobTicket {
+    long long id;
+    std::future<CalculationResult> result;
+};
+
+/*
+ * Постановка задания в очередь. Параметры проверяются сразу (prepareJob):
+ * при ошибке возвращается false, причина выводится в std::cerr.
+ * Если расчет бросил исключение, его получает future.
+ * */
+bool submitJob(const JobConfig &config, JobTicket &ticket);
+
+/*
+ * Отмена задания. Задание из очереди не выполняется, его future
+ * получает исключение std::future_error (broken_promise); выполняемое задание
+ * останавливается после текущих блоков и возвращает частичный результат
+ * с cancelled = true. Выполняемое задание в режиме pstl (SchedulingMode::ParallelAlgorithm)
+ * отменить нельзя: оно досчитывается и возвращает полный результат с cancelled = false.
+ * Возвращает false, если задание уже завершено или неизвестно.
+ * */
+bool cancelJob(long long id);
+
+/*
+ * Отмена всех заданий, ожидание выполняемых, закрытие кэша результатов
+ * и завершение потоков пула.
+ * Вызывается перед выходом из программы.
+ * */
+void shutdownJobs();
+
+#endif //JOBS_H
@@ -0,0 +1,1003 @@
+#include "kernels.h"
+
+#include <cmath>
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC позволяет использовать интринсики без ключей /arch
+#define TARGET_AVX2
+#define TARGET_AVX512
+#else
+// GCC и Clang требуют явно разрешить набор инструкций для функции
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+// Запрет автовекторизации (GCC объединяет независимые скалярные аккумуляторы в вектор)
+#if defined(__GNUC__) && !defined(__clang__)
+#define NO_VECTORIZE __attribute__((optimize("no-tree-vectorize")))
+#else
+#define NO_VECTORIZE
+#endif
+
+bool parsePrecision(const std::string &name, Precision &precision) {
+    if (name == "reference")
+        precision = Precision::Reference;
+    else if (name == "exact")
+        precision = Precision::Exact;
+    else if (name == "fast")
+        precision = Precision::Fast;
+    else
+        return false;
+    return true;
+}
+
+bool parseAccumulation(const std::string &name, Accumulation &accumulation) {
+    if (name == "plain")
+        accumulation = Accumulation::Plain;
+    else if (name == "compensated")
+        accumulation = Accumulation::Compensated;
+    else if (name == "double-double")
+        accumulation = Accumulation::DoubleDouble;
+    else if (name == "fixed128")
+        accumulation = Accumulation::Fixed128;
+    else
+        return false;
+    return true;
+}
+
+double divideByIterations(double sum, long long n) {
+    return sum / n;
+}
+
+/*
+ * Исходный вариант расчета - одна итерация за раз,
+ * вызов pow и последовательная зависимость по сумме.
+ * */
+double scalarKernel(long long start, long long end, long long n) {
+    double sum = 0;
+    for (long long i = start; i < end; i++) {
+        sum += 4 / (1 + pow((i + 0.5) / n, 2));
+    }
+    return sum;
+}
+
+/*
+ * Векторные ядра.
+ * Вектор idx хранит значения (i + 0.5) для нескольких подряд идущих i.
+ * Каждый из четырех аккумуляторов обрабатывает свою "полосу" итераций,
+ * поэтому сложения в разных аккумуляторах не зависят друг от друга
+ * и могут выполняться конвейерно.
+ * Значения i + 0.5 представимы в double точно (до 2^52),
+ * поэтому инкремент индексов не накапливает погрешность.
+ * Хвост блока, не кратный ширине развертки, досчитывается скалярно.
+ *
+ * Реализации - шаблоны от N и B (0 - значение берется из аргументов).
+ * При N != 0 число итераций и шаг становятся константами времени компиляции,
+ * при B != 0 ядро считает ровно B итераций от start: число проходов цикла
+ * известно компилятору, а если B кратно ширине развертки, хвоста нет вовсе.
+ * Экземпляры для распространенных N и B выбираются через specializeKernel.
+ * */
+
+// Нужен ли скалярный хвост блоку из B итераций при развертке на width
+template<long long B, long long width>
+constexpr bool hasTail() {
+    return B == 0 || B % width != 0;
+}
+
+template<long long N, long long B>
+static double sse2KernelImpl(long long start, long long end, long long n) {
+    if (N)
+        n = N;
+    if (B)
+        end = start + B;
+
+    const __m128d four = _mm_set1_pd(4.0);
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d nVector = _mm_set1_pd((double) n);
+    const __m128d step = _mm_set1_pd(8.0);
+
+    __m128d idx0 = _mm_set_pd(start + 1.5, start + 0.5);
+    __m128d idx1 = _mm_add_pd(idx0, _mm_set1_pd(2.0));
+    __m128d idx2 = _mm_add_pd(idx0, _mm_set1_pd(4.0));
+    __m128d idx3 = _mm_add_pd(idx0, _mm_set1_pd(6.0));
+
+    __m128d sum0 = _mm_setzero_pd();
+    __m128d sum1 = _mm_setzero_pd();
+    __m128d sum2 = _mm_setzero_pd();
+    __m128d sum3 = _mm_setzero_pd();
+
+    long long i = start;
+    for (; i + 8 <= end; i += 8) {
+        __m128d x0 = _mm_div_pd(idx0, nVector);
+        __m128d x1 = _mm_div_pd(idx1, nVector);
+        __m128d x2 = _mm_div_pd(idx2, nVector);
+        __m128d x3 = _mm_div_pd(idx3, nVector);
+        sum0 = _mm_add_pd(sum0, _mm_div_pd(four, _mm_add_pd(one, _mm_mul_pd(x0, x0))));
+        sum1 = _mm_add_pd(sum1, _mm_div_pd(four, _mm_add_pd(one, _mm_mul_pd(x1, x1))));
+        sum2 = _mm_add_pd(sum2, _mm_div_pd(four, _mm_add_pd(one, _mm_mul_pd(x2, x2))));
+        sum3 = _mm_add_pd(sum3, _mm_div_pd(four, _mm_add_pd(one, _mm_mul_pd(x3, x3))));
+        idx0 = _mm_add_pd(idx0, step);
+        idx1 = _mm_add_pd(idx1, step);
+        idx2 = _mm_add_pd(idx2, step);
+        idx3 = _mm_add_pd(idx3, step);
+    }
+
+    __m128d sum = _mm_add_pd(_mm_add_pd(sum0, sum1), _mm_add_pd(sum2, sum3));
+    double lanes[2];
+    _mm_storeu_pd(lanes, sum);
+
+    return lanes[0] + lanes[1] + (hasTail<B, 8>() ? scalarKernel(i, end, n) : 0);
+}
+
+double sse2Kernel(long long start, long long end, long long n) {
+    return sse2KernelImpl<0, 0>(start, end, n);
+}
+
+template<long long N, long long B>
+TARGET_AVX2
+static double avx2KernelImpl(long long start, long long end, long long n) {
+    if (N)
+        n = N;
+    if (B)
+        end = start + B;
+
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d nVector = _mm256_set1_pd((double) n);
+    const __m256d step = _mm256_set1_pd(16.0);
+
+    __m256d idx0 = _mm256_set_pd(start + 3.5, start + 2.5, start + 1.5, start + 0.5);
+    __m256d idx1 = _mm256_add_pd(idx0, _mm256_set1_pd(4.0));
+    __m256d idx2 = _mm256_add_pd(idx0, _mm256_set1_pd(8.0));
+    __m256d idx3 = _mm256_add_pd(idx0, _mm256_set1_pd(12.0));
+
+    __m256d sum0 = _mm256_setzero_pd();
+    __m256d sum1 = _mm256_setzero_pd();
+    __m256d sum2 = _mm256_setzero_pd();
+    __m256d sum3 = _mm256_setzero_pd();
+
+    long long i = start;
+    for (; i + 16 <= end; i += 16) {
+        __m256d x0 = _mm256_div_pd(idx0, nVector);
+        __m256d x1 = _mm256_div_pd(idx1, nVector);
+        __m256d x2 = _mm256_div_pd(idx2, nVector);
+        __m256d x3 = _mm256_div_pd(idx3, nVector);
+        sum0 = _mm256_add_pd(sum0, _mm256_div_pd(four, _mm256_fmadd_pd(x0, x0, one)));
+        sum1 = _mm256_add_pd(sum1, _mm256_div_pd(four, _mm256_fmadd_pd(x1, x1, one)));
+        sum2 = _mm256_add_pd(sum2, _mm256_div_pd(four, _mm256_fmadd_pd(x2, x2, one)));
+        sum3 = _mm256_add_pd(sum3, _mm256_div_pd(four, _mm256_fmadd_pd(x3, x3, one)));
+        idx0 = _mm256_add_pd(idx0, step);
+        idx1 = _mm256_add_pd(idx1, step);
+        idx2 = _mm256_add_pd(idx2, step);
+        idx3 = _mm256_add_pd(idx3, step);
+    }
+
+    __m256d sum = _mm256_add_pd(_mm256_add_pd(sum0, sum1), _mm256_add_pd(sum2, sum3));
+    double lanes[4];
+    _mm256_storeu_pd(lanes, sum);
+
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + (hasTail<B, 16>() ? scalarKernel(i, end, n) : 0);
+}
+
+double avx2Kernel(long long start, long long end, long long n) {
+    return avx2KernelImpl<0, 0>(start, end, n);
+}
+
+/*
+ * Сумма восьми double: половины складываются как в _mm512_reduce_add_pd,
+ * но через формы с обнулением, без неопределенных векторов,
+ * на которые GCC выдает -Wuninitialized внутри avx512fintrin.h
+ * (в GCC 12 и _mm512_castpd512_pd256 - это extractf64x4 без маски).
+ * */
+TARGET_AVX512
+static inline double avx512Sum(__m512d v) {
+    __m256d half = _mm256_add_pd(_mm512_maskz_extractf64x4_pd(0xFF, v, 0), _mm512_maskz_extractf64x4_pd(0xFF, v, 1));
+    double lanes[4];
+    _mm256_storeu_pd(lanes, half);
+    return (lanes[0] + lanes[2]) + (lanes[1] + lanes[3]);
+}
+
+template<long long N, long long B>
+TARGET_AVX512
+static double avx512KernelImpl(long long start, long long end, long long n) {
+    if (N)
+        n = N;
+    if (B)
+        end = start + B;
+
+    const __m512d four = _mm512_set1_pd(4.0);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d nVector = _mm512_set1_pd((double) n);
+    const __m512d step = _mm512_set1_pd(32.0);
+
+    __m512d idx0 = _mm512_set_pd(start + 7.5, start + 6.5, start + 5.5, start + 4.5,
+                                 start + 3.5, start + 2.5, start + 1.5, start + 0.5);
+    __m512d idx1 = _mm512_add_pd(idx0, _mm512_set1_pd(8.0));
+    __m512d idx2 = _mm512_add_pd(idx0, _mm512_set1_pd(16.0));
+    __m512d idx3 = _mm512_add_pd(idx0, _mm512_set1_pd(24.0));
+
+    __m512d sum0 = _mm512_setzero_pd();
+    __m512d sum1 = _mm512_setzero_pd();
+    __m512d sum2 = _mm512_setzero_pd();
+    __m512d sum3 = _mm512_setzero_pd();
+
+    long long i = start;
+    for (; i + 32 <= end; i += 32) {
+        __m512d x0 = _mm512_div_pd(idx0, nVector);
+        __m512d x1 = _mm512_div_pd(idx1, nVector);
+        __m512d x2 = _mm512_div_pd(idx2, nVector);
+        __m512d x3 = _mm512_div_pd(idx3, nVector);
+        sum0 = _mm512_add_pd(sum0, _mm512_div_pd(four, _mm512_fmadd_pd(x0, x0, one)));
+        sum1 = _mm512_add_pd(sum1, _mm512_div_pd(four, _mm512_fmadd_pd(x1, x1, one)));
+        sum2 = _mm512_add_pd(sum2, _mm512_div_pd(four, _mm512_fmadd_pd(x2, x2, one)));
+        sum3 = _mm512_add_pd(sum3, _mm512_div_pd(four, _mm512_fmadd_pd(x3, x3, one)));
+        idx0 = _mm512_add_pd(idx0, step);
+        idx1 = _mm512_add_pd(idx1, step);
+        idx2 = _mm512_add_pd(idx2, step);
+        idx3 = _mm512_add_pd(idx3, step);
+    }
+
+    __m512d sum = _mm512_add_pd(_mm512_add_pd(sum0, sum1), _mm512_add_pd(sum2, sum3));
+
+    return avx512Sum(sum) + (hasTail<B, 32>() ? scalarKernel(i, end, n) : 0);
+}
+
+double avx512Kernel(long long start, long long end, long long n) {
+    return avx512KernelImpl<0, 0>(start, end, n);
+}
+
+/*
+ * Ядра со снижением стоимости операций (Precision::Exact и Precision::Fast).
+ * Деление (i + 0.5) / n заменено умножением на заранее посчитанный шаг h = 1 / n,
+ * pow(x, 2) - умножением x * x.
+ * Сама точка x не накапливается сложением x += h (каждое сложение округляется,
+ * и погрешность растет с длиной блока): накапливается точный индекс i + 0.5,
+ * а x получается одним умножением.
+ * В варианте Fast деление 4 / (1 + x^2) заменено приближенной обратной
+ * величиной (rcp) с двумя итерациями Ньютона r = r * (2 - d * r),
+ * каждая из которых удваивает число верных бит.
+ * */
+
+double scalarReducedKernel(long long start, long long end, long long n) {
+    const double h = 1.0 / n;
+    double sum = 0;
+    double idx = start + 0.5;
+    for (long long i = start; i < end; i++, idx += 1.0) {
+        double x = idx * h;
+        sum += 4 / (1 + x * x);
+    }
+    return sum;
+}
+
+// Обратная величина через rcpss (12 бит) и две итерации Ньютона
+static inline double fastReciprocal(double d) {
+    double r = _mm_cvtss_f32(_mm_rcp_ss(_mm_set_ss((float) d)));
+    r = r * (2 - d * r);
+    r = r * (2 - d * r);
+    return r;
+}
+
+double scalarFastKernel(long long start, long long end, long long n) {
+    const double h = 1.0 / n;
+    double sum = 0;
+    double idx = start + 0.5;
+    for (long long i = start; i < end; i++, idx += 1.0) {
+        double x = idx * h;
+        sum += fastReciprocal(1 + x * x);
+    }
+    return 4 * sum;
+}
+
+/*
+ * Скалярные ядра с K независимыми аккумуляторами (параллелизм на уровне инструкций).
+ * В scalarKernel каждое сложение ждет результата предыдущего, т.е. итерация
+ * занимает не меньше задержки сложения (около 4 тактов). Здесь итерация i
+ * прибавляется к аккумулятору (i - start) % K, и в конвейере одновременно
+ * до K независимых сложений; аккумуляторы складываются попарно в конце блока.
+ * Формулы слагаемых - как в ядрах Reference, Exact и Fast, векторизация запрещена,
+ * чтобы выигрыш от ILP измерялся отдельно от SIMD.
+ * */
+template<Precision precision>
+static inline double ilpTerm(double idx, double h, long long n) {
+    if (precision == Precision::Reference)
+        return 4 / (1 + pow(idx / n, 2));
+    double x = idx * h;
+    if (precision == Precision::Fast)
+        return fastReciprocal(1 + x * x);
+    return 4 / (1 + x * x);
+}
+
+template<int K, Precision precision>
+NO_VECTORIZE static double ilpKernel(long long start, long long end, long long n) {
+    static_assert(K >= 1, "ILP kernel needs at least one accumulator");
+    const double h = 1.0 / n;
+    double sums[K] = {};
+    long long i = start;
+    double idx = start + 0.5;
+    // K - константа времени компиляции, внутренний цикл развертывается полностью
+    for (; i + K <= end; i += K, idx += K) {
+        for (int j = 0; j < K; j++)
+            sums[j] += ilpTerm<precision>(idx + j, h, n);
+    }
+    for (; i < end; i++, idx += 1.0)
+        sums[0] += ilpTerm<precision>(idx, h, n);
+
+    for (int width = 1; width < K; width *= 2) {
+        for (int j = 0; j + width < K; j += 2 * width)
+            sums[j] += sums[j + width];
+    }
+    return precision == Precision::Fast ? 4 * sums[0] : sums[0];
+}
+
+/*
+ * Накопление суммы с повышенной точностью (Accumulation, см. kernels.h).
+ * Compensated: к каждой сумме прилагается накопленная ошибка округления,
+ * ошибка одного сложения вычисляется точно безветвевым TwoSum (Knuth),
+ * который, в отличие от Fast2Sum (Kahan), не требует |sum| >= |term|.
+ * DoubleDouble: сумма хранится парой (hi, lo) и нормируется после каждого
+ * сложения (lo < ulp(hi) / 2), т.е. ошибка не накапливается в lo отдельно.
+ * Fixed128: слагаемые переводятся в число с фиксированной точкой Q47.80
+ * (__int128) и складываются точно; округление одно - при переводе суммы в double.
+ * Слагаемые ядер не больше 4, поэтому без переполнения можно сложить
+ * 2^127 / 2^82 ~ 3.5e13 слагаемых. Слагаемые меньше 2^-28 теряют младшие биты,
+ * слагаемые от 2^23 не поддерживаются (переполнение при переводе в целое).
+ * Векторные ядра ведут такие аккумуляторы в каждой полосе и объединяют их
+ * в скалярном аккумуляторе; в Fixed128 128-битных целых полос нет, поэтому
+ * слагаемые считаются векторно, а складываются скалярно.
+ * */
+
+#ifdef __SIZEOF_INT128__
+#define HAS_FIXED128 1
+
+struct FixedPoint {
+    __int128 value;
+
+    /*
+     * term * 2^80 переводится в целое двумя преобразованиями в 64 бита
+     * (cvttsd2si) вместо медленного библиотечного double -> __int128:
+     * целая и дробная части term * 2^40 вычисляются точно.
+     * */
+    void add(double term) {
+        double scaled = term * 0x1p40;
+        long long whole = (long long) scaled;
+        long long fraction = (long long) ((scaled - (double) whole) * 0x1p40);
+        value += ((__int128) whole << 40) + fraction;
+    }
+
+    double toDouble() const {
+        return (double) value * 0x1p-80;
+    }
+};
+#else
+// У компилятора (MSVC) нет 128-битных целых - Fixed128 недоступен
+#define HAS_FIXED128 0
+
+struct FixedPoint {
+    void add(double) {}
+
+    double toDouble() const {
+        return 0;
+    }
+};
+#endif
+
+template<Accumulation accumulation>
+struct ScalarAccumulator {
+    double sum;
+    double compensation;
+    FixedPoint fixed;
+
+    void add(double term) {
+        if constexpr (accumulation == Accumulation::Plain) {
+            sum += term;
+        } else if constexpr (accumulation == Accumulation::Compensated) {
+            double total = sum + term;
+            double virtualTerm = total - sum;
+            compensation += (sum - (total - virtualTerm)) + (term - virtualTerm);
+            sum = total;
+        } else if constexpr (accumulation == Accumulation::DoubleDouble) {
+            double total = sum + term;
+            double virtualTerm = total - sum;
+            double error = (sum - (total - virtualTerm)) + (term - virtualTerm) + compensation;
+            sum = total + error;
+            compensation = error - (sum - total);
+        } else {
+            fixed.add(term);
+        }
+    }
+
+    // Добавление ошибки округления другого аккумулятора
+    void compensate(double error) {
+        compensation += error;
+    }
+
+    double total() const {
+        if constexpr (accumulation == Accumulation::Fixed128)
+            return fixed.toDouble();
+        else if constexpr (accumulation == Accumulation::Plain)
+            return sum;
+        else
+            return sum + compensation;
+    }
+};
+
+// Слагаемые [start, end) ядер Exact (4 / (1 + x^2)) и Fast (1 / (1 + x^2)) в аккумулятор
+template<bool fast, Accumulation accumulation>
+static void accumulateReduced(long long start, long long end, long long n, ScalarAccumulator<accumulation> &total) {
+    const double h = 1.0 / n;
+    double idx = start + 0.5;
+    for (long long i = start; i < end; i++, idx += 1.0) {
+        double x = idx * h;
+        total.add(fast ? fastReciprocal(1 + x * x) : 4 / (1 + x * x));
+    }
+}
+
+template<bool fast, Accumulation accumulation>
+static double scalarAccumulatedKernel(long long start, long long end, long long n) {
+    ScalarAccumulator<accumulation> total{};
+    accumulateReduced<fast>(start, end, n, total);
+    return fast ? 4 * total.total() : total.total();
+}
+
+/*
+ * Векторные аккумуляторы. Члены не инициализируются конструктором
+ * (он был бы без атрибута target), аккумулятор обнуляется как агрегат: {}.
+ * */
+#define VECTOR_ACCUMULATOR(Name, Vector, Width, Add, Sub, Store, Target) \
+template<Accumulation accumulation> \
+struct Name { \
+    Vector sum; \
+    Vector compensation; \
+    FixedPoint fixed; \
+    \
+    Target void add(Vector term) { \
+        if constexpr (accumulation == Accumulation::Plain) { \
+            sum = Add(sum, term); \
+        } else if constexpr (accumulation == Accumulation::Compensated) { \
+            Vector total = Add(sum, term); \
+            Vector virtualTerm = Sub(total, sum); \
+            Vector error = Add(Sub(sum, Sub(total, virtualTerm)), Sub(term, virtualTerm)); \
+            compensation = Add(compensation, error); \
+            sum = total; \
+        } else if constexpr (accumulation == Accumulation::DoubleDouble) { \
+            Vector total = Add(sum, term); \
+            Vector virtualTerm = Sub(total, sum); \
+            Vector error = Add(Add(Sub(sum, Sub(total, virtualTerm)), Sub(term, virtualTerm)), compensation); \
+            sum = Add(total, error); \
+            compensation = Sub(error, Sub(sum, total)); \
+        } else { \
+            double lanes[Width]; \
+            Store(lanes, term); \
+            for (double lane : lanes) \
+                fixed.add(lane); \
+        } \
+    } \
+    \
+    Target void mergeInto(ScalarAccumulator<accumulation> &total) const { \
+        if constexpr (accumulation == Accumulation::Fixed128) { \
+            if constexpr (HAS_FIXED128) \
+                total.fixed.value += fixed.value; \
+        } else { \
+            double sums[Width], errors[Width]; \
+            Store(sums, sum); \
+            Store(errors, compensation); \
+            for (int lane = 0; lane < Width; lane++) { \
+                total.add(sums[lane]); \
+                total.compensate(errors[lane]); \
+            } \
+        } \
+    } \
+};
+
+VECTOR_ACCUMULATOR(Sse2Accumulator, __m128d, 2, _mm_add_pd, _mm_sub_pd, _mm_storeu_pd, )
+VECTOR_ACCUMULATOR(Avx2Accumulator, __m256d, 4, _mm256_add_pd, _mm256_sub_pd, _mm256_storeu_pd, TARGET_AVX2)
+VECTOR_ACCUMULATOR(Avx512Accumulator, __m512d, 8, _mm512_add_pd, _mm512_sub_pd, _mm512_storeu_pd, TARGET_AVX512)
+
+#undef VECTOR_ACCUMULATOR
+
+// Обратная величина двух double через rcpps (12 бит) и две итерации Ньютона
+static inline __m128d sse2Reciprocal(__m128d d) {
+    const __m128d two = _mm_set1_pd(2.0);
+    __m128d r = _mm_cvtps_pd(_mm_rcp_ps(_mm_cvtpd_ps(d)));
+    r = _mm_mul_pd(r, _mm_sub_pd(two, _mm_mul_pd(d, r)));
+    r = _mm_mul_pd(r, _mm_sub_pd(two, _mm_mul_pd(d, r)));
+    return r;
+}
+
+template<bool fast, Accumulation accumulation, long long N, long long B>
+static double sse2ReducedKernelImpl(long long start, long long end, long long n) {
+    if (N)
+        n = N;
+    if (B)
+        end = start + B;
+
+    const __m128d four = _mm_set1_pd(4.0);
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d h = _mm_set1_pd(1.0 / n);
+    const __m128d step = _mm_set1_pd(8.0);
+
+    __m128d idx0 = _mm_set_pd(start + 1.5, start + 0.5);
+    __m128d idx1 = _mm_add_pd(idx0, _mm_set1_pd(2.0));
+    __m128d idx2 = _mm_add_pd(idx0, _mm_set1_pd(4.0));
+    __m128d idx3 = _mm_add_pd(idx0, _mm_set1_pd(6.0));
+
+    Sse2Accumulator<accumulation> sum0{}, sum1{}, sum2{}, sum3{};
+
+    long long i = start;
+    for (; i + 8 <= end; i += 8) {
+        __m128d x0 = _mm_mul_pd(idx0, h);
+        __m128d x1 = _mm_mul_pd(idx1, h);
+        __m128d x2 = _mm_mul_pd(idx2, h);
+        __m128d x3 = _mm_mul_pd(idx3, h);
+        __m128d d0 = _mm_add_pd(one, _mm_mul_pd(x0, x0));
+        __m128d d1 = _mm_add_pd(one, _mm_mul_pd(x1, x1));
+        __m128d d2 = _mm_add_pd(one, _mm_mul_pd(x2, x2));
+        __m128d d3 = _mm_add_pd(one, _mm_mul_pd(x3, x3));
+        if (fast) {
+            sum0.add(sse2Reciprocal(d0));
+            sum1.add(sse2Reciprocal(d1));
+            sum2.add(sse2Reciprocal(d2));
+            sum3.add(sse2Reciprocal(d3));
+        } else {
+            sum0.add(_mm_div_pd(four, d0));
+            sum1.add(_mm_div_pd(four, d1));
+            sum2.add(_mm_div_pd(four, d2));
+            sum3.add(_mm_div_pd(four, d3));
+        }
+        idx0 = _mm_add_pd(idx0, step);
+        idx1 = _mm_add_pd(idx1, step);
+        idx2 = _mm_add_pd(idx2, step);
+        idx3 = _mm_add_pd(idx3, step);
+    }
+
+    if constexpr (accumulation != Accumulation::Plain) {
+        ScalarAccumulator<accumulation> total{};
+        sum0.mergeInto(total);
+        sum1.mergeInto(total);
+        sum2.mergeInto(total);
+        sum3.mergeInto(total);
+        accumulateReduced<fast>(i, end, n, total);
+        return fast ? 4 * total.total() : total.total();
+    }
+
+    __m128d sum = _mm_add_pd(_mm_add_pd(sum0.sum, sum1.sum), _mm_add_pd(sum2.sum, sum3.sum));
+    if (fast)
+        sum = _mm_mul_pd(sum, four);
+    double lanes[2];
+    _mm_storeu_pd(lanes, sum);
+
+    if (!hasTail<B, 8>())
+        return lanes[0] + lanes[1];
+    return lanes[0] + lanes[1] + (fast ? scalarFastKernel(i, end, n) : scalarReducedKernel(i, end, n));
+}
+
+double sse2ReducedKernel(long long start, long long end, long long n) {
+    return sse2ReducedKernelImpl<false, Accumulation::Plain, 0, 0>(start, end, n);
+}
+
+double sse2FastKernel(long long start, long long end, long long n) {
+    return sse2ReducedKernelImpl<true, Accumulation::Plain, 0, 0>(start, end, n);
+}
+
+// Обратная величина четырех double через rcpps (12 бит) и две итерации Ньютона
+TARGET_AVX2
+static inline __m256d avx2Reciprocal(__m256d d) {
+    const __m256d two = _mm256_set1_pd(2.0);
+    __m256d r = _mm256_cvtps_pd(_mm_rcp_ps(_mm256_cvtpd_ps(d)));
+    r = _mm256_mul_pd(r, _mm256_fnmadd_pd(d, r, two));
+    r = _mm256_mul_pd(r, _mm256_fnmadd_pd(d, r, two));
+    return r;
+}
+
+template<bool fast, Accumulation accumulation, long long N, long long B>
+TARGET_AVX2
+static double avx2ReducedKernelImpl(long long start, long long end, long long n) {
+    if (N)
+        n = N;
+    if (B)
+        end = start + B;
+
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d h = _mm256_set1_pd(1.0 / n);
+    const __m256d step = _mm256_set1_pd(16.0);
+
+    __m256d idx0 = _mm256_set_pd(start + 3.5, start + 2.5, start + 1.5, start + 0.5);
+    __m256d idx1 = _mm256_add_pd(idx0, _mm256_set1_pd(4.0));
+    __m256d idx2 = _mm256_add_pd(idx0, _mm256_set1_pd(8.0));
+    __m256d idx3 = _mm256_add_pd(idx0, _mm256_set1_pd(12.0));
+
+    Avx2Accumulator<accumulation> sum0{}, sum1{}, sum2{}, sum3{};
+
+    long long i = start;
+    for (; i + 16 <= end; i += 16) {
+        __m256d x0 = _mm256_mul_pd(idx0, h);
+        __m256d x1 = _mm256_mul_pd(idx1, h);
+        __m256d x2 = _mm256_mul_pd(idx2, h);
+        __m256d x3 = _mm256_mul_pd(idx3, h);
+        __m256d d0 = _mm256_fmadd_pd(x0, x0, one);
+        __m256d d1 = _mm256_fmadd_pd(x1, x1, one);
+        __m256d d2 = _mm256_fmadd_pd(x2, x2, one);
+        __m256d d3 = _mm256_fmadd_pd(x3, x3, one);
+        if (fast) {
+            sum0.add(avx2Reciprocal(d0));
+            sum1.add(avx2Reciprocal(d1));
+            sum2.add(avx2Reciprocal(d2));
+            sum3.add(avx2Reciprocal(d3));
+        } else {
+            sum0.add(_mm256_div_pd(four, d0));
+            sum1.add(_mm256_div_pd(four, d1));
+            sum2.add(_mm256_div_pd(four, d2));
+            sum3.add(_mm256_div_pd(four, d3));
+        }
+        idx0 = _mm256_add_pd(idx0, step);
+        idx1 = _mm256_add_pd(idx1, step);
+        idx2 = _mm256_add_pd(idx2, step);
+        idx3 = _mm256_add_pd(idx3, step);
+    }
+
+    if constexpr (accumulation != Accumulation::Plain) {
+        ScalarAccumulator<accumulation> total{};
+        sum0.mergeInto(total);
+        sum1.mergeInto(total);
+        sum2.mergeInto(total);
+        sum3.mergeInto(total);
+        accumulateReduced<fast>(i, end, n, total);
+        return fast ? 4 * total.total() : total.total();
+    }
+
+    __m256d sum = _mm256_add_pd(_mm256_add_pd(sum0.sum, sum1.sum), _mm256_add_pd(sum2.sum, sum3.sum));
+    if (fast)
+        sum = _mm256_mul_pd(sum, four);
+    double lanes[4];
+    _mm256_storeu_pd(lanes, sum);
+
+    if (!hasTail<B, 16>())
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3])
+           + (fast ? scalarFastKernel(i, end, n) : scalarReducedKernel(i, end, n));
+}
+
+double avx2ReducedKernel(long long start, long long end, long long n) {
+    return avx2ReducedKernelImpl<false, Accumulation::Plain, 0, 0>(start, end, n);
+}
+
+double avx2FastKernel(long long start, long long end, long long n) {
+    return avx2ReducedKernelImpl<true, Accumulation::Plain, 0, 0>(start, end, n);
+}
+
+// Обратная величина восьми double через rcp14pd (14 бит) и две итерации Ньютона
+TARGET_AVX512
+static inline __m512d avx512Reciprocal(__m512d d) {
+    const __m512d two = _mm512_set1_pd(2.0);
+    __m512d r = _mm512_maskz_rcp14_pd(0xFF, d);
+    r = _mm512_mul_pd(r, _mm512_fnmadd_pd(d, r, two));
+    r = _mm512_mul_pd(r, _mm512_fnmadd_pd(d, r, two));
+    return r;
+}
+
+template<bool fast, Accumulation accumulation, long long N, long long B>
+TARGET_AVX512
+static double avx512ReducedKernelImpl(long long start, long long end, long long n) {
+    if (N)
+        n = N;
+    if (B)
+        end = start + B;
+
+    const __m512d four = _mm512_set1_pd(4.0);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d h = _mm512_set1_pd(1.0 / n);
+    const __m512d step = _mm512_set1_pd(32.0);
+
+    __m512d idx0 = _mm512_set_pd(start + 7.5, start + 6.5, start + 5.5, start + 4.5,
+                                 start + 3.5, start + 2.5, start + 1.5, start + 0.5);
+    __m512d idx1 = _mm512_add_pd(idx0, _mm512_set1_pd(8.0));
+    __m512d idx2 = _mm512_add_pd(idx0, _mm512_set1_pd(16.0));
+    __m512d idx3 = _mm512_add_pd(idx0, _mm512_set1_pd(24.0));
+
+    Avx512Accumulator<accumulation> sum0{}, sum1{}, sum2{}, sum3{};
+
+    long long i = start;
+    for (; i + 32 <= end; i += 32) {
+        __m512d x0 = _mm512_mul_pd(idx0, h);
+        __m512d x1 = _mm512_mul_pd(idx1, h);
+        __m512d x2 = _mm512_mul_pd(idx2, h);
+        __m512d x3 = _mm512_mul_pd(idx3, h);
+        __m512d d0 = _mm512_fmadd_pd(x0, x0, one);
+        __m512d d1 = _mm512_fmadd_pd(x1, x1, one);
+        __m512d d2 = _mm512_fmadd_pd(x2, x2, one);
+        __m512d d3 = _mm512_fmadd_pd(x3, x3, one);
+        if (fast) {
+            sum0.add(avx512Reciprocal(d0));
+            sum1.add(avx512Reciprocal(d1));
+            sum2.add(avx512Reciprocal(d2));
+            sum3.add(avx512Reciprocal(d3));
+        } else {
+            sum0.add(_mm512_div_pd(four, d0));
+            sum1.add(_mm512_div_pd(four, d1));
+            sum2.add(_mm512_div_pd(four, d2));
+            sum3.add(_mm512_div_pd(four, d3));
+        }
+        idx0 = _mm512_add_pd(idx0, step);
+        idx1 = _mm512_add_pd(idx1, step);
+        idx2 = _mm512_add_pd(idx2, step);
+        idx3 = _mm512_add_pd(idx3, step);
+    }
+
+    if constexpr (accumulation != Accumulation::Plain) {
+        ScalarAccumulator<accumulation> total{};
+        sum0.mergeInto(total);
+        sum1.mergeInto(total);
+        sum2.mergeInto(total);
+        sum3.mergeInto(total);
+        accumulateReduced<fast>(i, end, n, total);
+        return fast ? 4 * total.total() : total.total();
+    }
+
+    __m512d sum = _mm512_add_pd(_mm512_add_pd(sum0.sum, sum1.sum), _mm512_add_pd(sum2.sum, sum3.sum));
+    if (fast)
+        sum = _mm512_mul_pd(sum, four);
+
+    if (!hasTail<B, 32>())
+        return avx512Sum(sum);
+    return avx512Sum(sum) + (fast ? scalarFastKernel(i, end, n) : scalarReducedKernel(i, end, n));
+}
+
+double avx512ReducedKernel(long long start, long long end, long long n) {
+    return avx512ReducedKernelImpl<false, Accumulation::Plain, 0, 0>(start, end, n);
+}
+
+double avx512FastKernel(long long start, long long end, long long n) {
+    return avx512ReducedKernelImpl<true, Accumulation::Plain, 0, 0>(start, end, n);
+}
+
+/*
+ * Специализированные ядра.
+ * Блок ровно из B итераций считается экземпляром fixed,
+ * прочие (последний неполный блок, блоки режима Guided) - variable;
+ * оба экземпляра используют N как константу.
+ * */
+template<Kernel fixed, Kernel variable, long long N, long long B>
+static double specializedKernel(long long start, long long end, long long) {
+    if (end - start == B)
+        return fixed(start, end, N);
+    return variable(start, end, N);
+}
+
+struct SpecializedKernel {
+    Kernel generic;
+    long long n;
+    long long blockSize;
+    Kernel function;
+};
+
+#define SPECIALIZATION(generic, impl, N, B) \
+    {generic, N, B, specializedKernel<impl<N, B>, impl<N, 0>, N, B>}
+
+/*
+ * Для каждого векторного ядра - N = 10^7, 10^8, 10^9
+ * и размеры блока: 8307040 (по умолчанию) и 2^20.
+ * Оба размера кратны 32 - ширине развертки самого широкого ядра.
+ * */
+#define SPECIALIZATIONS(generic, impl) \
+    SPECIALIZATION(generic, impl, 10000000, 8307040), \
+    SPECIALIZATION(generic, impl, 10000000, 1048576), \
+    SPECIALIZATION(generic, impl, 100000000, 8307040), \
+    SPECIALIZATION(generic, impl, 100000000, 1048576), \
+    SPECIALIZATION(generic, impl, 1000000000, 8307040), \
+    SPECIALIZATION(generic, impl, 1000000000, 1048576)
+
+template<long long N, long long B>
+static double sse2Exact(long long start, long long end, long long n) {
+    return sse2ReducedKernelImpl<false, Accumulation::Plain, N, B>(start, end, n);
+}
+
+template<long long N, long long B>
+static double sse2Fast(long long start, long long end, long long n) {
+    return sse2ReducedKernelImpl<true, Accumulation::Plain, N, B>(start, end, n);
+}
+
+template<long long N, long long B>
+static double avx2Exact(long long start, long long end, long long n) {
+    return avx2ReducedKernelImpl<false, Accumulation::Plain, N, B>(start, end, n);
+}
+
+template<long long N, long long B>
+static double avx2Fast(long long start, long long end, long long n) {
+    return avx2ReducedKernelImpl<true, Accumulation::Plain, N, B>(start, end, n);
+}
+
+template<long long N, long long B>
+static double avx512Exact(long long start, long long end, long long n) {
+    return avx512ReducedKernelImpl<false, Accumulation::Plain, N, B>(start, end, n);
+}
+
+template<long long N, long long B>
+static double avx512Fast(long long start, long long end, long long n) {
+    return avx512ReducedKernelImpl<true, Accumulation::Plain, N, B>(start, end, n);
+}
+
+static const SpecializedKernel specializedKernels[] = {
+        SPECIALIZATIONS(sse2Kernel, sse2KernelImpl),
+        SPECIALIZATIONS(sse2ReducedKernel, sse2Exact),
+        SPECIALIZATIONS(sse2FastKernel, sse2Fast),
+        SPECIALIZATIONS(avx2Kernel, avx2KernelImpl),
+        SPECIALIZATIONS(avx2ReducedKernel, avx2Exact),
+        SPECIALIZATIONS(avx2FastKernel, avx2Fast),
+        SPECIALIZATIONS(avx512Kernel, avx512KernelImpl),
+        SPECIALIZATIONS(avx512ReducedKernel, avx512Exact),
+        SPECIALIZATIONS(avx512FastKernel, avx512Fast),
+};
+
+#undef SPECIALIZATIONS
+#undef SPECIALIZATION
+
+Kernel specializeKernel(Kernel kernel, long long n, long long blockSize) {
+    for (const SpecializedKernel &entry : specializedKernels) {
+        if (entry.generic == kernel && entry.n == n && entry.blockSize == blockSize)
+            return entry.function;
+    }
+    return kernel;
+}
+
+/*
+ * Проверка возможностей процессора.
+ * Для AVX и AVX-512 недостаточно флага CPUID: нужно еще, чтобы ОС
+ * сохраняла соответствующие регистры при переключении контекста
+ * (флаг OSXSAVE и биты регистра XCR0).
+ * */
+#ifdef _MSC_VER
+static bool cpuSupportsAvx2() {
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = info[2] & (1 << 27);
+    bool fma = info[2] & (1 << 12);
+    if (!osxsave || !fma || (_xgetbv(0) & 0x6) != 0x6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 5);
+}
+
+static bool cpuSupportsAvx512() {
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = info[2] & (1 << 27);
+    if (!osxsave || (_xgetbv(0) & 0xE6) != 0xE6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 16);
+}
+#else
+static bool cpuSupportsAvx2() {
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+static bool cpuSupportsAvx512() {
+    return __builtin_cpu_supports("avx512f");
+}
+#endif
+
+static bool alwaysSupported() {
+    return true;
+}
+
+template<bool fast, Accumulation accumulation>
+static double sse2AccumulatedKernel(long long start, long long end, long long n) {
+    return sse2ReducedKernelImpl<fast, accumulation, 0, 0>(start, end, n);
+}
+
+template<bool fast, Accumulation accumulation>
+static double avx2AccumulatedKernel(long long start, long long end, long long n) {
+    return avx2ReducedKernelImpl<fast, accumulation, 0, 0>(start, end, n);
+}
+
+template<bool fast, Accumulation accumulation>
+static double avx512AccumulatedKernel(long long start, long long end, long long n) {
+    return avx512ReducedKernelImpl<fast, accumulation, 0, 0>(start, end, n);
+}
+
+#if HAS_FIXED128
+#define FIXED128_KERNEL(kernel) kernel
+#else
+#define FIXED128_KERNEL(kernel) nullptr
+#endif
+
+/*
+ * Ядра Exact и Fast со всеми способами накопления, кроме Plain
+ * (в порядке Accumulation).
+ * */
+#define ACCUMULATED_KERNELS(kernel) \
+    {{kernel<false, Accumulation::Compensated>, kernel<false, Accumulation::DoubleDouble>, \
+      FIXED128_KERNEL((kernel<false, Accumulation::Fixed128>))}, \
+     {kernel<true, Accumulation::Compensated>, kernel<true, Accumulation::DoubleDouble>, \
+      FIXED128_KERNEL((kernel<true, Accumulation::Fixed128>))}}
+
+#define ACCUMULATED_NAMES(name) \
+    {{name " (exact, compensated)", name " (exact, double-double)", name " (exact, fixed128)"}, \
+     {name " (fast, compensated)", name " (fast, double-double)", name " (fast, fixed128)"}}
+
+/*
+ * Таблица ядер: для каждого набора инструкций -
+ * ядра для всех режимов точности (в порядке Precision)
+ * и ядра Exact и Fast с накоплением повышенной точности.
+ * */
+struct KernelSet {
+    const char *option;
+    const char *names[3];
+    Kernel functions[3];
+    bool (*supported)();
+    const char *accumulatedNames[2][3];
+    Kernel accumulated[2][3];
+};
+
+/*
+ * Скалярные ядра ILP с K аккумуляторами (-k ilpK); способов накопления
+ * повышенной точности у них нет. Автоматически не выбираются:
+ * расположены после SSE2, который поддерживается всегда.
+ * */
+#define ILP_KERNEL_SET(K) \
+        {"ilp" #K, {"ILP x" #K, "ILP x" #K " (exact)", "ILP x" #K " (fast)"}, \
+                {ilpKernel<K, Precision::Reference>, ilpKernel<K, Precision::Exact>, ilpKernel<K, Precision::Fast>}, \
+                alwaysSupported, {{"ILP x" #K, "ILP x" #K, "ILP x" #K}, {"ILP x" #K, "ILP x" #K, "ILP x" #K}}, \
+                {{nullptr, nullptr, nullptr}, {nullptr, nullptr, nullptr}}}
+
+static const KernelSet kernelSets[] = {
+        {"avx512", {"AVX-512", "AVX-512 (exact)", "AVX-512 (fast)"},
+                {avx512Kernel, avx512ReducedKernel, avx512FastKernel}, cpuSupportsAvx512,
+                ACCUMULATED_NAMES("AVX-512"), ACCUMULATED_KERNELS(avx512AccumulatedKernel)},
+        {"avx2",   {"AVX2",    "AVX2 (exact)",    "AVX2 (fast)"},
+                {avx2Kernel,   avx2ReducedKernel,   avx2FastKernel},   cpuSupportsAvx2,
+                ACCUMULATED_NAMES("AVX2"),    ACCUMULATED_KERNELS(avx2AccumulatedKernel)},
+        // SSE2 входит в базовый набор инструкций x86-64
+        {"sse2",   {"SSE2",    "SSE2 (exact)",    "SSE2 (fast)"},
+                {sse2Kernel,   sse2ReducedKernel,   sse2FastKernel},   alwaysSupported,
+                ACCUMULATED_NAMES("SSE2"),    ACCUMULATED_KERNELS(sse2AccumulatedKernel)},
+        ILP_KERNEL_SET(8),
+        ILP_KERNEL_SET(4),
+        ILP_KERNEL_SET(2),
+        {"scalar", {"scalar",  "scalar (exact)",  "scalar (fast)"},
+                {scalarKernel, scalarReducedKernel, scalarFastKernel}, alwaysSupported,
+                ACCUMULATED_NAMES("scalar"),  ACCUMULATED_KERNELS(scalarAccumulatedKernel)},
+};
+
+#undef ILP_KERNEL_SET
+#undef ACCUMULATED_NAMES
+#undef ACCUMULATED_KERNELS
+#undef FIXED128_KERNEL
+
+// Ядро набора set для режима точности и способа накопления (function = nullptr - такого нет)
+static KernelInfo selectKernel(const KernelSet &set, Precision precision, Accumulation accumulation) {
+    if (accumulation == Accumulation::Plain)
+        return {set.names[(int) precision], set.functions[(int) precision]};
+    if (precision == Precision::Reference)
+        return {set.names[0], nullptr};
+    int row = precision == Precision::Fast, column = (int) accumulation - 1;
+    return {set.accumulatedNames[row][column], set.accumulated[row][column]};
+}
+
+KernelInfo detectBestKernel(Precision precision, Accumulation accumulation) {
+    // Таблица упорядочена от самого быстрого ядра к самому медленному
+    for (const KernelSet &set : kernelSets) {
+        if (set.supported())
+            return selectKernel(set, precision, accumulation);
+    }
+    return {kernelSets[0].names[(int) precision], nullptr};
+}
+
+bool findKernel(const std::string &name, Precision precision, KernelInfo &result, Accumulation accumulation) {
+    KernelInfo found = {nullptr, nullptr};
+    if (name == "auto") {
+        found = detectBestKernel(precision, accumulation);
+    } else {
+        for (const KernelSet &set : kernelSets) {
+            if (name == set.option && set.supported())
+                found = selectKernel(set, precision, accumulation);
+        }
+    }
+    if (!found.function)
+        return false;
+    result = found;
+    return true;
+}
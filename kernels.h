@@ -0,0 +1,102 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <string>
+
+/*
+ * Ядра расчета - функции, считающие сумму
+ * 4 / (1 + ((i + 0.5) / n)^2) для i из [start, end).
+ * Помимо скалярного ядра есть векторные (SSE2, AVX2, AVX-512),
+ * считающие несколько средних точек за одну инструкцию
+ * в нескольких независимых аккумуляторах.
+ * Подходящее ядро выбирается во время выполнения по CPUID.
+ * */
+
+/*
+ * Режим точности ядра:
+ *      Reference - исходная формула: деление на n и (скалярно) pow;
+ *      Exact - шаг h = 1 / n, x * x вместо pow, точное деление;
+ *      Fast - как Exact, но 4 / (1 + x^2) через приближенную обратную
+ *      величину с уточнением методом Ньютона (погрешность ~1e-15 на слагаемое).
+ * */
+enum class Precision {
+    Reference,
+    Exact,
+    Fast
+};
+
+// Разбор названия режима точности (reference, exact, fast).
+bool parsePrecision(const std::string &name, Precision &precision);
+
+/*
+ * Способ накопления суммы внутри ядра (для Precision::Exact и Precision::Fast):
+ *      Plain - обычное сложение double, ошибка округления растет с длиной блока;
+ *      Compensated - с компенсацией ошибки округления (Kahan-Neumaier через TwoSum);
+ *      DoubleDouble - сумма в виде пары double (около 106 бит мантиссы);
+ *      Fixed128 - точное сложение в 128-битном числе с фиксированной точкой
+ *      (только компиляторы с __int128, т.е. не MSVC).
+ * */
+enum class Accumulation {
+    Plain,
+    Compensated,
+    DoubleDouble,
+    Fixed128
+};
+
+// Разбор названия способа накопления (plain, compensated, double-double, fixed128).
+bool parseAccumulation(const std::string &name, Accumulation &accumulation);
+
+typedef double (*Kernel)(long long start, long long end, long long n);
+
+/*
+ * Нормировка итоговой суммы ядра: для исходной формулы
+ * (средние точки на [0, 1]) - деление на n.
+ * Ядра других квадратурных формул (см. integrands.h) задают свою.
+ * */
+typedef double (*Normalization)(double sum, long long n);
+
+double divideByIterations(double sum, long long n);
+
+struct KernelInfo {
+    const char *name;
+    Kernel function;
+    Normalization normalize = divideByIterations;
+};
+
+double scalarKernel(long long start, long long end, long long n);
+double sse2Kernel(long long start, long long end, long long n);
+double avx2Kernel(long long start, long long end, long long n);
+double avx512Kernel(long long start, long long end, long long n);
+
+double scalarReducedKernel(long long start, long long end, long long n);
+double sse2ReducedKernel(long long start, long long end, long long n);
+double avx2ReducedKernel(long long start, long long end, long long n);
+double avx512ReducedKernel(long long start, long long end, long long n);
+
+double scalarFastKernel(long long start, long long end, long long n);
+double sse2FastKernel(long long start, long long end, long long n);
+double avx2FastKernel(long long start, long long end, long long n);
+double avx512FastKernel(long long start, long long end, long long n);
+
+// Выбор самого быстрого ядра, поддерживаемого процессором и ОС.
+KernelInfo detectBestKernel(Precision precision = Precision::Reference,
+                            Accumulation accumulation = Accumulation::Plain);
+
+/*
+ * Поиск ядра по имени: auto, scalar, sse2, avx2, avx512.
+ * Возвращает false, если ядро неизвестно, не поддерживается процессором
+ * или способ накопления не поддерживается для этого режима точности или компилятором.
+ * */
+bool findKernel(const std::string &name, Precision precision, KernelInfo &result,
+                Accumulation accumulation = Accumulation::Plain);
+
+/*
+ * Экземпляр ядра kernel, скомпилированный для конкретных n и размера блока
+ * (без хвоста развертки и с константным шагом), если такой есть в таблице
+ * специализаций, иначе - само kernel.
+ * Специализированное ядро корректно для любых диапазонов,
+ * но быстрее на полных блоках и только при заданном n.
+ * */
+Kernel specializeKernel(Kernel kernel, long long n, long long blockSize);
+
+#endif //KERNELS_H
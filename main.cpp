@@ -1,9 +1,26 @@
 #include <iostream>
-#include <windows.h>
 #include <cmath>
 #include <iomanip>
-#include <atomic>
 #include <chrono>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <fstream>
+
+#include "affinity.h"
+#include "backend.h"
+#include "distributed.h"
+#include "engine.h"
+#include "integrands.h"
+#include "jobs.h"
+#include "kernels.h"
+#include "offload.h"
+#include "perfcounters.h"
+#include "statistics.h"
+#include "trace.h"
 
 /*
  * Программа компилировалась с использованием MSVC
@@ -12,251 +29,911 @@
  * fetch_add для атомарного инкремента глобальной переменной
  * в потоке (fetch_add и fetch_sub для floating-point типов
  * появились только в С++20).
+ * Сейчас программа собирается также GCC 12 и новее:
+ * Win32 API используется только в backend_win32.cpp,
+ * на остальных платформах потоки создаются через std::thread
+ * (см. backend.h).
+ *
+ * Сам расчет вынесен в библиотеку движка (engine.h, jobs.h),
+ * здесь - разбор параметров, запуск заданий и вывод результатов.
  * */
 
-// Точность - 100000000 по заданию (количество итераций)
-#define N 100000000
-
-// Размер блока - 10*номерСтудБилета = 830704*10 = 8307040
-#define BLOCK_SIZE 8307040
+// Промежуточная оценка прогрессивного расчета
+void printProgress(const ProgressReport &report) {
+    std::cout << std::setprecision(6) << "[" << report.elapsed << " ms] "
+              << report.completedBlocks << "/" << report.numberOfBlocks << " blocks, estimate "
+              << std::setprecision(std::numeric_limits<double>::max_digits10) << report.estimate
+              << std::setprecision(6) << " +- " << report.errorBound << std::endl;
+}
 
-// Количество блоков: распределяем N итераций по BLOCK_SIZE блокам.
-// Если без остатка не делится, то добавляем еще один блок
-#define NUMBER_OF_BLOCKS N/BLOCK_SIZE +(N % BLOCK_SIZE ? 1 : 0)
+// Расчет с параметрами job на threads потоках (параметры уже проверены)
+CalculationResult calculatePi(const JobConfig &job, int threads) {
+    JobConfig config = job;
+    config.threads = threads;
+    config.progress = printProgress;
+    JobTicket ticket;
+    submitJob(config, ticket);
+    CalculationResult result = ticket.result.get();
+
+    for (int thread : result.failedPins) {
+        std::cout << "Could not pin thread #" << thread << " to processor "
+                  << result.placement[thread].group << ":" << result.placement[thread].number << std::endl;
+    }
+    if (result.priorityFailed)
+        std::cerr << "Could not change thread priority, some threads ran at normal priority" << std::endl;
+    return result;
+}
 
+// Вывод загрузки каждого потока
+void printThreadStats(const CalculationResult &result, SchedulingMode mode) {
+    for (size_t i = 0; i < result.busyTime.size(); i++) {
+        std::cout << "Thread #" << i;
+        if (!result.placement.empty()) {
+            const LogicalProcessor &processor = result.placement[i];
+            std::cout << " CPU: " << processor.group << ":" << processor.number
+                      << " Core: " << processor.core << " Node: " << processor.node
+                      << " Class: " << processor.efficiencyClass;
+        }
+        std::cout << " Blocks: " << result.blocks[i]
+                  << " Busy: " << result.busyTime[i] << " ms";
+        if (mode == SchedulingMode::WorkStealing)
+            std::cout << " Steals: " << result.steals[i] << " Failed steals: " << result.failedSteals[i];
+        std::cout << std::endl;
+    }
+}
 
-// Массив HANDLE'ов потоков
-HANDLE *threadsArray;
-// Массив HANDLE'ов событий
-HANDLE *eventsArray;
+// Счетчик или n/a, если он недоступен
+std::string counterText(long long value) {
+    return value < 0 ? "n/a" : std::to_string(value);
+}
 
 /*
- * std::atomic - атомарные операции в C++ начиная с С++11
- * В С++20 добавлены атомарные операции сложения и вычитания для floating-point типов
- * (source: https://en.cppreference.com/w/cpp/atomic/atomic#Specializations_for_floating-point_types)
+ * Счетчики процессора по потокам и их сумма.
+ * IPC (инструкций за такт) - по тактам, когда поток выполнялся,
+ * поэтому низкий IPC означает ожидание данных или длинные операции (деление),
+ * а не простой потока.
  * */
-std::atomic<long> nextBlock = 0;
-std::atomic<double> pi = 0;
+void printCounters(const CalculationResult &result) {
+    PerfCounters total = {0, 0, 0, 0};
+    auto add = [](long long &sum, long long value) { sum = sum < 0 || value < 0 ? -1 : sum + value; };
+    auto print = [](const PerfCounters &counters) {
+        std::cout << " Cycles: " << counterText(counters.cycles)
+                  << " Instructions: " << counterText(counters.instructions) << " IPC: ";
+        if (counters.cycles > 0 && counters.instructions >= 0)
+            std::cout << (double) counters.instructions / counters.cycles;
+        else
+            std::cout << "n/a";
+        std::cout << " Cache misses: " << counterText(counters.cacheMisses)
+                  << " Context switches: " << counterText(counters.contextSwitches) << std::endl;
+    };
+    std::cout << "Counters (" << perfCountersName() << "):" << std::endl;
+    for (size_t i = 0; i < result.counters.size(); i++) {
+        const PerfCounters &counters = result.counters[i];
+        std::cout << "Thread #" << i;
+        print(counters);
+        add(total.cycles, counters.cycles);
+        add(total.instructions, counters.instructions);
+        add(total.cacheMisses, counters.cacheMisses);
+        add(total.contextSwitches, counters.contextSwitches);
+    }
+    std::cout << "Total";
+    print(total);
+}
 
-// Функция, которую выполняет поток
-DWORD WINAPI calculateIteration(CONST LPVOID threadID) {
+/*
+ * Энергия расчета и пропускная способность на ватт:
+ * итераций в секунду на ватт = итераций на джоуль.
+ * Считаются только посчитанные итерации (без взятых из кэша).
+ * */
+void printEnergy(const CalculationResult &result) {
+    if (result.energy < 0) {
+        std::cout << "Energy: n/a (RAPL counters are not available or not readable)" << std::endl;
+        return;
+    }
+    long long iterations = 0;
+    for (long long threadIterations : result.iterations)
+        iterations += threadIterations;
+    std::cout << "Energy: " << result.energy << " J"
+              << " Average power: " << (result.time > 0 ? result.energy / (result.time / 1e3) : 0) << " W"
+              << " Iterations per joule: " << (result.energy > 0 ? iterations / result.energy : 0) << std::endl;
+}
 
-    // "Часть" числа Пи, которую считаем в данном потоке
-    double threadPi = 0;
+/*
+ * Пропускная способность потоков по классам эффективности ядер
+ * (известны только при привязке потоков к процессорам).
+ * */
+void printClassThroughput(const CalculationResult &result) {
+    struct ClassTotal {
+        int threads = 0;
+        long long iterations = 0;
+        double busyTime = 0;
+    };
+    std::map<int, ClassTotal> classes;
+    for (size_t i = 0; i < result.placement.size(); i++) {
+        ClassTotal &total = classes[result.placement[i].efficiencyClass];
+        total.threads++;
+        total.iterations += result.iterations[i];
+        total.busyTime += result.busyTime[i];
+    }
+    for (const auto &entry : classes) {
+        const ClassTotal &total = entry.second;
+        std::cout << "Core class " << entry.first << ": threads " << total.threads
+                  << " iterations " << total.iterations
+                  << " Iterations/s per thread: " << (total.busyTime > 0 ? total.iterations / (total.busyTime / 1e3) : 0)
+                  << std::endl;
+    }
+}
 
+// Формат вывода результатов бенчмарка
+enum class OutputFormat {
+    Text,
+    Csv,
+    Json
+};
+
+// Параметры запуска, не относящиеся к самому расчету
+struct RunOptions {
+    // Числа потоков, для которых проводится расчет
+    std::vector<int> threadCounts;
+    // Замер ускорения по нескольким числам потоков
+    bool sweep = false;
+    // Вывод загрузки каждого потока
+    bool threadStats = false;
+    // Режим бенчмарка (см. runBenchmark)
+    bool benchmark = false;
+    int warmupRuns = 2;
+    int repetitions = 10;
+    OutputFormat format = OutputFormat::Text;
+    // Файл для результатов бенчмарка (пусто - стандартный вывод)
+    std::string outputFile;
+    // Параметры расчета (число потоков - первое из threadCounts)
+    JobConfig job;
+    // Повторный расчет с Precision::Reference для сравнения точности
+    bool verify = false;
+    // Файл для трассировки последнего расчета (см. trace.h)
+    std::string traceFile;
+    std::string precisionName = "reference";
+    std::string accumulationName = "plain";
     /*
-     * Получаем номер потока, который передали
-     * в функцию при создании потока.
-     * Номер потока также равен номеру
-     * первого блока для расчета.
+     * Распределенный режим (см. distributed.h): координатор слушает
+     * coordinatorPort и ждет nodes узлов; узел (node) соединяется
+     * с coordinatorHost:coordinatorPort.
      * */
-    int currentBlock = (int) threadID;
+    int coordinatorPort = 0;
+    int nodes = 1;
+    // Сколько координатор ждет подключения всех узлов, мс
+    int connectTimeout = 60000;
+    // Итераций в части (0 - по четыре части на узел)
+    long long shardSize = 0;
+    bool node = false;
+    std::string coordinatorHost;
+
+    bool coordinator() const {
+        return coordinatorPort > 0 && !node;
+    }
+};
 
-    /*
-     * Обсчитываем блоки в потоке
-     * пока номер текущего блока
-     * не превысил заданное количество блоков.
-     * */
-    while (currentBlock <= NUMBER_OF_BLOCKS) {
-        /*
-         * При каждом заходе в цикл рассчитывается
-         * начальная и конечная граница обсчета.
-         * При этом начальная граница - currentBlock * BLOCK_SIZE,
-         * а currentBlock изменяется в конце цикла,
-         * получая значение nextBlock+1.
-         * Т.о. поток обсчитал блок, получил следущий блок, приостановился.
-         * */
-
-        /*
-         * Начальная границ обсчета.
-         * */
-        int startIteration = currentBlock * BLOCK_SIZE;
-
-        /*
-         * Конечная граница обсчета.
-         * */
-        int endIteration = (currentBlock + 1) * BLOCK_SIZE;
-
-        /*
-         * Если больше считать не нужно,
-         * то и цикл ниже запускать не нужно.
-         * */
-        if (endIteration > N){
-            endIteration = N;
+/*
+ * Замер ускорения: расчет для каждого числа потоков из threadCounts.
+ * Ускорение считается относительно первого расчета
+ * (обычно - в одном потоке).
+ * */
+void measureSpeedup(const JobConfig &job, const std::vector<int> &threadCounts) {
+    double baselineTime = 0;
+    for (int threads : threadCounts) {
+        CalculationResult result = calculatePi(job, threads);
+        if (baselineTime == 0) {
+            baselineTime = result.time;
+            std::cout << "Speedup is relative to " << threads << " thread(s)" << std::endl;
         }
 
-        /*
-         * Основная часть - расчет "фрагмента" Пи,
-         * соответствующего текущему блоку.
-         * */
-        for (int i = startIteration; i < endIteration; i++){
-            threadPi += 4 / (1 + pow((i + 0.5) / N, 2));
-        }
+        std::cout << "Threads: " << threads
+                  << " Pi = " << std::setprecision(std::numeric_limits<double>::max_digits10) << result.pi
+                  << std::setprecision(6)
+                  << " Time elapsed: " << result.time << " ms"
+                  << " Speedup: " << baselineTime / result.time
+                  << " Load imbalance: " << loadImbalance(result)
+                  << std::endl;
+    }
+}
+
+// Результаты бенчмарка для одного числа потоков
+struct BenchmarkRecord {
+    int threads;
+    // Время расчета, мкс
+    SampleSummary time;
+    double iterationsPerSecond;
+    double iterationsPerSecondPerThread;
+    // Параллельная эффективность: T1 / (Tp * p) по медианам
+    double efficiency;
+    double loadImbalance;
+    // Медиана времени подготовки потоков, мкс
+    double setupTime;
+    // Медиана времени итоговой редукции, мкс
+    double reductionTime;
+    long long blockSize;
+    double pi;
+    const char *kernel;
+};
+
+// Серия замеров для одного числа потоков: прогрев, затем repetitions замеров.
+BenchmarkRecord benchmarkThreads(int threads, const RunOptions &options) {
+    for (int i = 0; i < options.warmupRuns; i++)
+        calculatePi(options.job, threads);
+
+    std::vector<double> times, setupTimes, reductionTimes;
+    double imbalance = 0;
+    CalculationResult result;
+    for (int i = 0; i < options.repetitions; i++) {
+        result = calculatePi(options.job, threads);
+        times.push_back(result.time * 1000);
+        setupTimes.push_back(result.setupTime * 1000);
+        reductionTimes.push_back(result.reductionTime * 1000);
+        imbalance += loadImbalance(result);
+    }
 
-        /*
-         * Переводим событие, соответствующее потоку,
-         * в сигнальное состояние, сигнализируя об окончания расчета
-         * очередного блока.
-         * */
-        SetEvent(eventsArray[(int) threadID]);
-
-        /*
-         * Если это был не последний блок, приостанавливаем выполнение потока.
-         * */
-        if (nextBlock <= NUMBER_OF_BLOCKS) {
-            SuspendThread(threadsArray[(int) threadID]);
+    BenchmarkRecord record = {};
+    record.threads = threads;
+    record.time = summarize(times);
+    record.iterationsPerSecond = options.job.iterations / (record.time.median / 1e6);
+    record.iterationsPerSecondPerThread = record.iterationsPerSecond / threads;
+    record.loadImbalance = imbalance / options.repetitions;
+    record.setupTime = summarize(setupTimes).median;
+    record.reductionTime = summarize(reductionTimes).median;
+    record.blockSize = result.blockSize;
+    record.pi = result.pi;
+    record.kernel = result.kernel;
+    return record;
+}
+
+/*
+ * Бенчмарк: для каждого числа потоков - прогрев и серия замеров,
+ * статистика времени в микросекундах, пропускная способность
+ * и параллельная эффективность относительно расчета в одном потоке
+ * (если одного потока нет в списке, он замеряется дополнительно).
+ * */
+void runBenchmark(const RunOptions &options) {
+    std::vector<BenchmarkRecord> records;
+    for (int threads : options.threadCounts)
+        records.push_back(benchmarkThreads(threads, options));
+
+    double singleThreadMedian = 0;
+    for (const BenchmarkRecord &record : records) {
+        if (record.threads == 1)
+            singleThreadMedian = record.time.median;
+    }
+    if (singleThreadMedian == 0)
+        singleThreadMedian = benchmarkThreads(1, options).time.median;
+    for (BenchmarkRecord &record : records)
+        record.efficiency = singleThreadMedian / (record.time.median * record.threads);
+
+    std::ofstream file;
+    if (!options.outputFile.empty()) {
+        file.open(options.outputFile);
+        if (!file) {
+            std::cerr << "Could not open " << options.outputFile << std::endl;
+            return;
         }
+    }
+    std::ostream &out = options.outputFile.empty() ? std::cout : file;
+    const char *kernelName = records.front().kernel;
+    const char *modeName = schedulingModeName(options.job.mode);
+    const char *reductionName = reductionModeName(options.job.reduction);
+    const char *backend = threadingBackendName(options.job.mode);
+    long long numberOfIterations = options.job.iterations;
+    out << std::setprecision(std::numeric_limits<double>::max_digits10);
+
+    switch (options.format) {
+        case OutputFormat::Text:
+            out << std::setprecision(6)
+                << "Kernel: " << kernelName << " Backend: " << backend
+                << " Mode: " << modeName << " Reduction: " << reductionName
+                << " Iterations: " << numberOfIterations << std::endl
+                << "Warmup runs: " << options.warmupRuns << " Repetitions: " << options.repetitions << std::endl;
+            for (const BenchmarkRecord &record : records) {
+                out << "Threads: " << record.threads
+                    << " min/median/p95: " << record.time.min << "/" << record.time.median << "/"
+                    << record.time.p95 << " us"
+                    << " stddev: " << record.time.stddev << " us"
+                    << " Iterations/s: " << record.iterationsPerSecond
+                    << " per thread: " << record.iterationsPerSecondPerThread
+                    << " Efficiency: " << record.efficiency
+                    << " Load imbalance: " << record.loadImbalance
+                    << " Setup: " << record.setupTime << " us"
+                    << " Reduction: " << record.reductionTime << " us"
+                    << std::endl;
+            }
+            break;
+        case OutputFormat::Csv:
+            out << "threads,mode,reduction,kernel,backend,iterations,block_size,repetitions,"
+                   "min_us,median_us,p95_us,mean_us,stddev_us,iterations_per_second,"
+                   "iterations_per_second_per_thread,efficiency,load_imbalance,setup_us,reduction_us,pi" << std::endl;
+            for (const BenchmarkRecord &record : records) {
+                out << record.threads << ',' << modeName << ',' << reductionName << ','
+                    << kernelName << ',' << backend << ',' << numberOfIterations << ','
+                    << record.blockSize << ',' << options.repetitions << ','
+                    << record.time.min << ',' << record.time.median << ',' << record.time.p95 << ','
+                    << record.time.mean << ',' << record.time.stddev << ','
+                    << record.iterationsPerSecond << ',' << record.iterationsPerSecondPerThread << ','
+                    << record.efficiency << ',' << record.loadImbalance << ',' << record.setupTime << ','
+                    << record.reductionTime << ','
+                    << record.pi << std::endl;
+            }
+            break;
+        case OutputFormat::Json:
+            out << "[" << std::endl;
+            for (size_t i = 0; i < records.size(); i++) {
+                const BenchmarkRecord &record = records[i];
+                out << "  {\"threads\": " << record.threads
+                    << ", \"mode\": \"" << modeName << "\""
+                    << ", \"reduction\": \"" << reductionName << "\""
+                    << ", \"kernel\": \"" << kernelName << "\""
+                    << ", \"backend\": \"" << backend << "\""
+                    << ", \"iterations\": " << numberOfIterations
+                    << ", \"block_size\": " << record.blockSize
+                    << ", \"repetitions\": " << options.repetitions
+                    << ", \"min_us\": " << record.time.min
+                    << ", \"median_us\": " << record.time.median
+                    << ", \"p95_us\": " << record.time.p95
+                    << ", \"mean_us\": " << record.time.mean
+                    << ", \"stddev_us\": " << record.time.stddev
+                    << ", \"iterations_per_second\": " << record.iterationsPerSecond
+                    << ", \"iterations_per_second_per_thread\": " << record.iterationsPerSecondPerThread
+                    << ", \"efficiency\": " << record.efficiency
+                    << ", \"load_imbalance\": " << record.loadImbalance
+                    << ", \"setup_us\": " << record.setupTime
+                    << ", \"reduction_us\": " << record.reductionTime
+                    << ", \"pi\": " << record.pi
+                    << "}" << (i + 1 < records.size() ? "," : "") << std::endl;
+            }
+            out << "]" << std::endl;
+            break;
+    }
+}
 
-        /*
-         * currentBlock = InterlockedExchangeAdd(&nextBlock, 1)
-         *            ^^^ тоже работает (currentBlock объявить как volatile long nextBlock = 0)
-         * source: https://docs.microsoft.com/en-us/windows/win32/api/winnt/nf-winnt-interlockedexchangeadd
-         * InterlockedExchangeAdd - атомарная операция сложения 32битных значений из Win32 API
-         * При этом в некотрых источниках написано, что volatile не предназначен
-         * стандартом языка для обеспечения атомарности операций в многопоточном программировании
-         * и volatile не рекомендуется использовать в таком контексте.
-         * */
-
-        /*
-         * Инкрементируем глобальную nextBlock и
-         * присваем полученное значение currentBlock.
-         * Таким образом поток получает следующий блок.
-         * */
-        currentBlock = nextBlock.fetch_add(1, std::memory_order::memory_order_relaxed);
+/*
+ * Проверка точности: тот же расчет с ядром Precision::Reference
+ * (тот же набор инструкций), разница результатов и ускорение.
+ * */
+void verifyAgainstReference(const CalculationResult &result, const RunOptions &options) {
+    if (options.job.genericIntegrand()) {
+        std::cout << "Verification compares kernel precisions and applies to pi with midpoint rule only" << std::endl;
+        return;
     }
 
-    /*
-     * Когда все блоки обсчитаны,
-     * собираем результаты вычислений данного потока
-     * в "глоабльное" Пи.
-     * */
-    pi.fetch_add(threadPi, std::memory_order_relaxed);
+    JobConfig referenceJob = options.job;
+    referenceJob.precision = Precision::Reference;
+    referenceJob.accumulation = Accumulation::Plain;
+    referenceJob.cacheFile.clear();
+    CalculationResult reference = calculatePi(referenceJob, options.threadCounts.front());
+
+    std::cout << "Reference kernel: " << reference.kernel << std::endl
+              << std::setprecision(std::numeric_limits<double>::max_digits10)
+              << "Reference Pi = " << reference.pi << std::endl
+              << std::setprecision(6)
+              << "Difference from reference: " << result.pi - reference.pi << std::endl
+              << "Reference error (|Pi - pi|): " << std::abs(reference.pi - reference.exactValue) << std::endl
+              << "Reference time: " << reference.time << " ms"
+              << " Speedup over reference: " << reference.time / result.time
+              << std::endl;
+}
 
-    return 0;
+// Числа потоков 1, 2, 4, ... вплоть до числа логических процессоров в системе.
+std::vector<int> powersOfTwoUpToProcessorCount() {
+    int processors = numberOfProcessors();
+
+    std::vector<int> threadCounts;
+    for (int threads = 1;; threads = std::min(threads * 2, processors)) {
+        threadCounts.push_back(threads);
+        if (threads == processors)
+            break;
+    }
+    return threadCounts;
 }
 
-void calculatePi() {
+void printUsage(const char *programName) {
+    const JobConfig defaults;
+    std::cout << "Usage: " << programName << " [options]" << std::endl
+              << "Without options parameters are read from standard input." << std::endl
+              << "  -t, --threads COUNT      number of threads" << std::endl
+              << "  -n, --iterations COUNT   number of iterations (default " << defaults.iterations << ")" << std::endl
+              << "  -b, --block-size COUNT   iterations per block (default " << defaults.blockSize << ")," << std::endl
+              << "                           minimal block in guided mode, auto - pick from thread count" << std::endl
+              << "  -m, --mode MODE          handshake | self | guided | stealing | pstl (default self);" << std::endl
+              << "                           pstl - std::transform_reduce(par_unseq), threads chosen by the library" << std::endl
+              << "  -r, --reduction MODE     atomic | sequential | pairwise | kahan | deterministic (default pairwise);" << std::endl
+              << "                           deterministic - tree over block sums, same bits for any thread count" << std::endl
+              << "  -k, --kernel KERNEL      auto | scalar | sse2 | avx2 | avx512 (default auto);" << std::endl
+              << "                           ilp2 | ilp4 | ilp8 - scalar with 2, 4 or 8 independent accumulators" << std::endl
+              << "  -p, --precision MODE     reference | exact | fast (default reference):" << std::endl
+              << "                           exact - multiply by 1/N and x*x instead of divide and pow," << std::endl
+              << "                           fast - also reciprocal estimate with Newton refinement" << std::endl
+              << "      --accumulation MODE  plain | compensated | double-double | fixed128 (default plain):" << std::endl
+              << "                           summation inside the -p exact and -p fast kernels" << std::endl
+              << "      --integrand NAME     pi (4/(1+x^2) on [0,1]) | sin (on [0,pi]) | gauss (exp(-x^2) on [0,1])" << std::endl
+              << "      --rule RULE          midpoint | trapezoid | simpson (default midpoint);" << std::endl
+              << "                           -k and -p apply to pi with midpoint rule only" << std::endl
+              << "      --time-budget MS     stop after MS milliseconds and report the estimate so far" << std::endl
+              << "      --target-error E     stop once the estimated error is at most E;" << std::endl
+              << "                           both print a running estimate after every block (self mode only)" << std::endl
+              << "      --no-specialize      do not use kernels compiled for the given N and block size" << std::endl
+              << "      --offload BLOCKS     add a GPU thread taking BLOCKS blocks per launch (self mode, pi only;" << std::endl
+              << "                           needs ENABLE_OFFLOAD)" << std::endl
+              << "      --fresh-threads      create threads for every run instead of reusing the pool" << std::endl
+              << "      --verify             rerun with the reference kernel and compare results" << std::endl
+              << "  -s, --sweep FROM:TO      run every thread count from FROM to TO and report speedup" << std::endl
+              << "  -s, --sweep auto         run 1, 2, 4, ... threads up to the number of processors" << std::endl
+              << "  -a, --affinity POLICY    none | compact | scatter | physical (default none);" << std::endl
+              << "                           on Windows pinning also spreads threads over processor groups" << std::endl
+              << "      --hybrid             size blocks by measured P-/E-core throughput (needs -a, self or guided)" << std::endl
+              << "      --thread-stats       print blocks and busy time of every thread" << std::endl
+              << "      --counters           print cycles, instructions, IPC, cache misses and context switches" << std::endl
+              << "                           of every thread (perf_event_open on Linux, cycles only on Windows)" << std::endl
+              << "      --duty-cycle F       compute only fraction F of the time: sleep after every block" << std::endl
+              << "      --idle-priority      run threads at idle priority (SCHED_IDLE, THREAD_PRIORITY_IDLE)" << std::endl
+              << "      --energy             print package energy (RAPL) and iterations per joule" << std::endl
+              << "      --benchmark          warmup and repeated runs with timing statistics" << std::endl
+              << "      --warmup COUNT       warmup runs per thread count (default 2)" << std::endl
+              << "      --repetitions COUNT  measured runs per thread count (default 10)" << std::endl
+              << "  -f, --format FORMAT      benchmark output: text | csv | json (default text)" << std::endl
+              << "  -o, --output FILE        write benchmark results to FILE" << std::endl
+              << "      --trace FILE         write per-thread block timeline of the last run" << std::endl
+              << "                           (FILE.json - Chrome trace, otherwise CSV; needs ENABLE_TRACING)" << std::endl
+              << "      --cache FILE         reuse sums stored in FILE and store new ones; doubling N" << std::endl
+              << "                           for trapezoid and simpson rules computes only the new points" << std::endl
+              << "      --coordinator PORT   hand out iteration shards to nodes connecting to PORT" << std::endl
+              << "      --nodes COUNT        nodes the coordinator waits for (default 1)" << std::endl
+              << "      --connect-timeout S  seconds the coordinator waits for all nodes (default 60)" << std::endl
+              << "      --shard-size COUNT   iterations per shard (default four shards per node)" << std::endl
+              << "      --node HOST:PORT     compute shards for the coordinator at HOST:PORT" << std::endl
+              << "                           with the local -t, -k, -b, -m, -r and -a settings" << std::endl
+              << "  -h, --help               show this help" << std::endl;
+}
+
+/*
+ * Разбор аргументов командной строки.
+ * Параметры расчета записываются в глобальные переменные,
+ * параметры запуска - в options.
+ * Возвращает false при ошибке в аргументах.
+ * */
+bool parseArguments(int argc, char *argv[], RunOptions &options) {
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+
+        if (argument == "-h" || argument == "--help") {
+            printUsage(argv[0]);
+            exit(0);
+        }
+
+        if (argument == "--thread-stats") {
+            options.threadStats = true;
+            continue;
+        }
+        if (argument == "--idle-priority") {
+            options.job.idlePriority = true;
+            continue;
+        }
+        if (argument == "--energy") {
+            options.job.measureEnergy = true;
+            continue;
+        }
+        if (argument == "--counters") {
+            options.job.counters = true;
+            continue;
+        }
+        if (argument == "--benchmark") {
+            options.benchmark = true;
+            continue;
+        }
+        if (argument == "--verify") {
+            options.verify = true;
+            continue;
+        }
+        if (argument == "--no-specialize") {
+            options.job.specializeKernels = false;
+            continue;
+        }
+        if (argument == "--hybrid") {
+            options.job.hybrid = true;
+            continue;
+        }
+        if (argument == "--fresh-threads") {
+            setPersistentWorkers(false);
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << argument << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+
+        try {
+            if (argument == "-t" || argument == "--threads") {
+                options.threadCounts = {std::stoi(value)};
+                options.sweep = false;
+            } else if (argument == "-n" || argument == "--iterations") {
+                options.job.iterations = std::stoll(value);
+            } else if (argument == "-b" || argument == "--block-size") {
+                options.job.autoBlockSize = value == "auto";
+                if (!options.job.autoBlockSize)
+                    options.job.blockSize = std::stoll(value);
+            } else if (argument == "-m" || argument == "--mode") {
+                if (value == "handshake")
+                    options.job.mode = SchedulingMode::Handshake;
+                else if (value == "self")
+                    options.job.mode = SchedulingMode::SelfScheduling;
+                else if (value == "guided")
+                    options.job.mode = SchedulingMode::Guided;
+                else if (value == "stealing")
+                    options.job.mode = SchedulingMode::WorkStealing;
+                else if (value == "pstl")
+                    options.job.mode = SchedulingMode::ParallelAlgorithm;
+                else {
+                    std::cerr << "Unknown scheduling mode " << value << std::endl;
+                    return false;
+                }
+            } else if (argument == "-r" || argument == "--reduction") {
+                if (value == "atomic")
+                    options.job.reduction = ReductionMode::Atomic;
+                else if (value == "sequential")
+                    options.job.reduction = ReductionMode::Sequential;
+                else if (value == "pairwise")
+                    options.job.reduction = ReductionMode::Pairwise;
+                else if (value == "kahan")
+                    options.job.reduction = ReductionMode::Kahan;
+                else if (value == "deterministic")
+                    options.job.reduction = ReductionMode::Deterministic;
+                else {
+                    std::cerr << "Unknown reduction mode " << value << std::endl;
+                    return false;
+                }
+            } else if (argument == "-a" || argument == "--affinity") {
+                if (!parseAffinityPolicy(value, options.job.affinity)) {
+                    std::cerr << "Unknown affinity policy " << value << std::endl;
+                    return false;
+                }
+            } else if (argument == "-k" || argument == "--kernel") {
+                options.job.kernel = value;
+            } else if (argument == "-p" || argument == "--precision") {
+                if (!parsePrecision(value, options.job.precision)) {
+                    std::cerr << "Unknown precision mode " << value << std::endl;
+                    return false;
+                }
+                options.precisionName = value;
+            } else if (argument == "--accumulation") {
+                if (!parseAccumulation(value, options.job.accumulation)) {
+                    std::cerr << "Unknown accumulation mode " << value << std::endl;
+                    return false;
+                }
+                options.accumulationName = value;
+            } else if (argument == "--coordinator") {
+                options.coordinatorPort = std::stoi(value);
+            } else if (argument == "--nodes") {
+                options.nodes = std::stoi(value);
+            } else if (argument == "--connect-timeout") {
+                options.connectTimeout = (int) (std::stod(value) * 1000);
+            } else if (argument == "--shard-size") {
+                options.shardSize = std::stoll(value);
+            } else if (argument == "--offload") {
+                if (!offloadSupported()) {
+                    std::cerr << "Offload is not available: build with -DENABLE_OFFLOAD=ON" << std::endl;
+                    return false;
+                }
+                options.job.offloadBlocks = std::stoll(value);
+            } else if (argument == "--node") {
+                size_t separator = value.rfind(':');
+                if (separator == std::string::npos) {
+                    std::cerr << "Coordinator address should be HOST:PORT" << std::endl;
+                    return false;
+                }
+                options.coordinatorHost = value.substr(0, separator);
+                options.coordinatorPort = std::stoi(value.substr(separator + 1));
+                options.node = true;
+            } else if (argument == "--duty-cycle") {
+                options.job.dutyCycle = std::stod(value);
+            } else if (argument == "--cache") {
+                options.job.cacheFile = value;
+            } else if (argument == "--trace") {
+                if (!tracingEnabled()) {
+                    std::cerr << "Tracing is not compiled in, configure with -DENABLE_TRACING=ON" << std::endl;
+                    return false;
+                }
+                options.traceFile = value;
+            } else if (argument == "--time-budget") {
+                options.job.timeBudget = std::stod(value);
+            } else if (argument == "--target-error") {
+                options.job.targetError = std::stod(value);
+            } else if (argument == "--integrand") {
+                options.job.integrand = value;
+            } else if (argument == "--rule") {
+                if (!parseQuadratureRule(value, options.job.rule)) {
+                    std::cerr << "Unknown quadrature rule " << value << std::endl;
+                    return false;
+                }
+            } else if (argument == "-s" || argument == "--sweep") {
+                options.sweep = true;
+                if (value == "auto") {
+                    options.threadCounts = powersOfTwoUpToProcessorCount();
+                } else {
+                    size_t separator = value.find(':');
+                    if (separator == std::string::npos) {
+                        std::cerr << "Sweep range should be FROM:TO" << std::endl;
+                        return false;
+                    }
+                    int from = std::stoi(value.substr(0, separator));
+                    int to = std::stoi(value.substr(separator + 1));
+                    options.threadCounts.clear();
+                    for (int threads = from; threads <= to; threads++)
+                        options.threadCounts.push_back(threads);
+                }
+            } else if (argument == "--warmup") {
+                options.warmupRuns = std::stoi(value);
+            } else if (argument == "--repetitions") {
+                options.repetitions = std::stoi(value);
+            } else if (argument == "-f" || argument == "--format") {
+                if (value == "text")
+                    options.format = OutputFormat::Text;
+                else if (value == "csv")
+                    options.format = OutputFormat::Csv;
+                else if (value == "json")
+                    options.format = OutputFormat::Json;
+                else {
+                    std::cerr << "Unknown output format " << value << std::endl;
+                    return false;
+                }
+            } else if (argument == "-o" || argument == "--output") {
+                options.outputFile = value;
+            } else {
+                std::cerr << "Unknown option " << argument << std::endl;
+                return false;
+            }
+        } catch (const std::logic_error &) {
+            std::cerr << "Invalid value for " << argument << ": " << value << std::endl;
+            return false;
+        }
+    }
+
+    // Координатор сам не считает, число потоков задается на узлах
+    if (!options.coordinator() && (options.threadCounts.empty() || options.threadCounts.front() < 1)) {
+        std::cerr << "Number of threads should be positive" << std::endl;
+        return false;
+    }
+    if (!options.coordinator())
+        options.job.threads = options.threadCounts.front();
+    if (options.warmupRuns < 0 || options.repetitions < 1) {
+        std::cerr << "Benchmark needs at least one repetition" << std::endl;
+        return false;
+    }
+    if (options.job.progressive() && (options.benchmark || options.sweep || options.coordinatorPort)) {
+        std::cerr << "Time budget and target error apply to a single local run" << std::endl;
+        return false;
+    }
+    if (!options.job.cacheFile.empty() && (options.benchmark || options.sweep || options.coordinatorPort)) {
+        std::cerr << "Result cache applies to a single local run" << std::endl;
+        return false;
+    }
+    // Потоки режима pstl выбирает библиотека, число потоков не перебирается
+    if (options.job.mode == SchedulingMode::ParallelAlgorithm && (options.benchmark || options.sweep)) {
+        std::cerr << "pstl mode does not control the number of threads, thread sweeps do not apply" << std::endl;
+        return false;
+    }
+    if (options.coordinatorPort && (options.benchmark || options.sweep)) {
+        std::cerr << "Distributed mode runs a single calculation" << std::endl;
+        return false;
+    }
+    if (options.coordinator() && (options.nodes < 1 || options.shardSize < 0 || options.connectTimeout <= 0)) {
+        std::cerr << "Coordinator needs at least one node, a positive shard size and connect timeout" << std::endl;
+        return false;
+    }
+    KernelInfo kernel;
+    double exactValue;
+    if (!prepareJob(options.job, kernel, exactValue))
+        return false;
+    if (options.job.offloadBlocks && !offloadDeviceAvailable())
+        std::cout << "No offload device found, offloaded blocks run on the host" << std::endl;
+    return true;
+}
+
+/*
+ * Интерактивный ввод параметров (запуск без аргументов).
+ * */
+void readParameters(RunOptions &options) {
     /*
      * Получаем количество потоков/
      * */
     int numberOfThreads;
-    std::cout << "Enter number of threads" << std::endl;
+    std::cout << "Enter number of threads (0 - measure speedup up to number of processors)" << std::endl;
     std::cin >> numberOfThreads;
+    options.sweep = numberOfThreads == 0;
+    options.threadCounts = options.sweep ? powersOfTwoUpToProcessorCount() : std::vector<int>{numberOfThreads};
+    options.job.threads = options.threadCounts.front();
 
     /*
-     * Cоздаем массивы HANDLE'ов событий и потоков
-     * в соответствии с введенным числом потоков.
+     * Получаем число итераций.
      * */
-    threadsArray = new HANDLE[numberOfThreads];
-    eventsArray = new HANDLE[numberOfThreads];
+    std::cout << "Enter number of iterations (" << options.job.iterations << " by default, 0 - keep default)"
+              << std::endl;
+    long long iterations;
+    std::cin >> iterations;
+    if (iterations > 0)
+        options.job.iterations = iterations;
 
     /*
-     * Создаем потоки в приостановленном состоянии
-     * и события в не сигнальном состоянии.
-     * При этом в каждый блок передается значение
-     * переменной цикла i. С помощью этого каждый
-     * поток получает "отправную" точку для начала расчета
-     * (первый блок).
+     * Получаем режим планирования блоков.
      * */
-    for (int i = 0; i < numberOfThreads; i++) {
-        threadsArray[i] = CreateThread(nullptr, 0, calculateIteration, (LPVOID) i, CREATE_SUSPENDED, nullptr);
-        if (!threadsArray[i])
-            std::cout << "Could not create thread #" << i << ". Error " << GetLastError() << std::endl;
-        eventsArray[i] = CreateEventA(nullptr, true, 0, nullptr);
-    }
+    int mode;
+    std::cout << "Enter scheduling mode (0 - suspend/resume handshake, 1 - self-scheduling, 2 - guided, "
+                 "3 - work stealing)" << std::endl;
+    std::cin >> mode;
+    options.job.mode = mode == 0 ? SchedulingMode::Handshake
+                                 : mode == 2 ? SchedulingMode::Guided
+                                             : mode == 3 ? SchedulingMode::WorkStealing : SchedulingMode::SelfScheduling;
 
     /*
-     * nextBlock - глобальный счетчик блоков.
-     * Так как выше каждый поток получил по блоку,
-     * то nextBlock = число потоков.
+     * Получаем ядро расчета: по умолчанию - самое быстрое из
+     * поддерживаемых процессором, скалярное - для сравнения.
      * */
-    nextBlock = numberOfThreads;
+    int kernelChoice;
+    std::cout << "Enter kernel (0 - best available (" << detectBestKernel().name << "), 1 - scalar)" << std::endl;
+    std::cin >> kernelChoice;
+    if (kernelChoice == 1)
+        options.job.kernel = "scalar";
+}
 
-    // Начинаем замерять время выполнения.
-    auto start = std::chrono::high_resolution_clock::now();
 
-    // Возобновляем выполнение всех потоков.
-    for (int i = 0; i <= numberOfThreads; i++) {
-        ResumeThread(threadsArray[i]);
-    }
+/*
+ * Узел распределенного расчета: параметры задания приходят от координатора,
+ * число потоков, набор инструкций ядра и планирование - локальные (nodeJob).
+ * */
+JobConfig nodeJob;
+
+bool configureDistributedJob(const DistributedJob &job) {
+    JobConfig config = nodeJob;
+    config.iterations = job.iterations;
+    config.integrand = job.integrand;
+    KernelInfo kernel;
+    double exactValue;
+    if (!parseQuadratureRule(job.rule, config.rule) || !parsePrecision(job.precision, config.precision)
+        || !parseAccumulation(job.accumulation, config.accumulation) || !prepareJob(config, kernel, exactValue))
+        return false;
+    nodeJob = config;
+
+    std::cout << "Job: " << config.iterations << " iterations, kernel " << kernel.name << ", "
+              << config.threads << " threads" << std::endl;
+    return true;
+}
 
-    /*
-     * nextBlock атомарно инкрементируется в потоках
-     * после завершения обсчета очередного блока.
-     * Атомарность позволяет обеспечить безопасный доступ
-     * к переменной из нескольких потоков:
-     *      1) Так как атомарная операция неделима, вторая атомарная
-     *      операция над одним и тем же объектом из другого потока
-     *      может получить состояние объекта только до или после
-     *      первой атомарной операции.
-     *      2) На основе своего аргумента memory_order атомарная
-     *      операция устанавливает требования упорядоченности для
-     *      видимости влияния других атомарных операций в том же потоке.
-     *      Следовательно, она подавляет оптимизации компилятора,
-     *      которые нарушают требования к упорядоченности.
-     * (source: https://docs.microsoft.com/ru-ru/cpp/standard-library/atomic?view=msvc-160)
-     * В этой работе атомарные операции используются для инкремента
-     * счетчика подсчета блоков nextBlock и для "сбора" результата вычислений из блоков
-     * в переменную pi (обе операции производятся в потоках).
-     * */
+double calculateShard(long long first, long long last) {
+    JobConfig shard = nodeJob;
+    shard.first = first;
+    shard.last = last;
+    return calculatePi(shard, shard.threads).sum;
+}
 
-    // Начинаем считать
-    while (nextBlock <= NUMBER_OF_BLOCKS) {
-        /*
-         * Ждем первого события, которое изменит состояние на сигнальное.
-         * Т.е. поток по окончании расчета очередного блока изменит состояния события
-         * и приостановится.
-         * suspendedThreadIndex получит индекс этого события (и приостановленного потока
-         * соответственно) в массиве events.
-         * */
-        unsigned int suspendedThreadIndex = WaitForMultipleObjects(numberOfThreads, eventsArray, false, INFINITE) - WAIT_OBJECT_0;
-
-        // Сбрасываем состояние этого события в не сигнальное.
-        ResetEvent(eventsArray[suspendedThreadIndex]);
-
-        // Возобновляем выполнение потока (он уже получил следующий блок)
-        ResumeThread(threadsArray[suspendedThreadIndex]);
+// Координатор: раздача частей узлам и вывод результата.
+bool runDistributed(const RunOptions &options) {
+    const JobConfig &config = options.job;
+    DistributedJob job = {config.iterations, config.integrand, quadratureRuleName(config.rule),
+                          options.precisionName, options.accumulationName};
+    long long shardSize = options.shardSize ? options.shardSize
+                                            : std::max(1LL, config.iterations / (4LL * options.nodes));
+    // Ядро координатора нужно только для нормировки суммы и точного значения
+    KernelInfo kernel;
+    double exactValue;
+    prepareJob(config, kernel, exactValue);
+
+    DistributedResult result;
+    if (!runCoordinator(options.coordinatorPort, options.nodes, job, shardSize, options.connectTimeout, result))
+        return false;
+    double value = kernel.normalize(result.sum, config.iterations);
+
+    std::cout << (config.genericIntegrand() ? "Integral = " : "Pi = ")
+              << std::setprecision(std::numeric_limits<double>::max_digits10) << value << std::endl
+              << std::setprecision(6)
+              << "Shards: " << result.shards << " of " << shardSize << " iterations" << std::endl
+              << "Time elapsed (since all nodes connected): " << result.time << " ms" << std::endl
+              << (config.genericIntegrand() ? "Error (|I - exact|): " : "Error (|Pi - pi|): ")
+              << std::abs(value - exactValue) << std::endl;
+    for (const NodeReport &node : result.nodes) {
+        std::cout << "Node " << node.name << ": threads " << node.threads << " shards " << node.shards
+                  << " busy " << node.busyTime << " ms" << std::endl;
     }
+    return true;
+}
 
-    /*
-     * Все блоки обсчитаны, нужно собрать результат.
-     * */
-    for (int i = 0; i < numberOfThreads; i++){
-        /*
-         * Для этого возобновляем все потоки, чтобы
-         * после основного цикла все потоки сложили свои результаты
-         * в глобальную переменную pi.
-         * */
-        ResumeThread(threadsArray[i]);
-    }
-
-    // Ждем пока все потоки не завершат своё выполнение.
-    WaitForMultipleObjects(numberOfThreads, threadsArray, true, INFINITE);
-
-    // Досчитываем Пи
-    pi = pi / N;
-
-    // Заканчиванием замерять время выполнения.
-    auto end = std::chrono::high_resolution_clock::now();
-    // Подсчитываем затраченное время.
-    auto time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+int main(int argc, char *argv[]) {
+    RunOptions options;
 
-    // Выводим результат и затраченное время
-    std::cout << "Pi = " << std::setprecision(N) << pi << std::endl
-         << "Not all decimal digits are shown due to system limitations" << std::endl
-         << "Time elapsed: " << time << " ms"
-         << std::endl;
+    if (argc > 1) {
+        if (!parseArguments(argc, argv, options)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+    } else {
+        readParameters(options);
+    }
+    const JobConfig &job = options.job;
+    KernelInfo kernel;
+    double exactValue;
+    if (!prepareJob(job, kernel, exactValue))
+        return 1;
+
+    if (options.node) {
+        nodeJob = job;
+        bool completed = runNode(options.coordinatorHost, options.coordinatorPort, job.threads,
+                                 configureDistributedJob, calculateShard);
+        shutdownJobs();
+        return completed ? 0 : 1;
+    }
+    if (options.coordinator()) {
+        bool completed = runDistributed(options);
+        shutdownJobs();
+        return completed ? 0 : 1;
+    }
 
-    // Закрываем HANDLE'ы событий и потоков.
-    for (int i = 0; i < numberOfThreads; i++) {
-        CloseHandle(threadsArray[i]);
-        CloseHandle(eventsArray[i]);
+    if (options.benchmark) {
+        runBenchmark(options);
+    } else if (options.sweep) {
+        std::cout << "Kernel: " << kernel.name << std::endl
+                  << "Threading backend: " << threadingBackendName(job.mode) << std::endl;
+        measureSpeedup(job, options.threadCounts);
+    } else {
+        CalculationResult result = calculatePi(job, job.threads);
+
+        // Выводим результат и затраченное время
+        // (в режиме pstl нет ни ядер, ни блоков, ни собственных потоков)
+        bool parallelAlgorithm = job.mode == SchedulingMode::ParallelAlgorithm;
+        std::cout << (job.genericIntegrand() ? "Integral = " : "Pi = ") << std::setprecision(std::numeric_limits<double>::max_digits10) << result.pi << std::endl
+                  << std::setprecision(6)
+                  << "Not all decimal digits are shown due to system limitations" << std::endl;
+        if (!parallelAlgorithm)
+            std::cout << "Kernel: " << result.kernel << std::endl;
+        std::cout << "Threading backend: " << threadingBackendName(job.mode) << std::endl;
+        if (!parallelAlgorithm)
+            std::cout << "Block size: " << result.blockSize
+                      << (result.specialized ? " (specialized kernel)" : "") << std::endl;
+        std::cout << "Time elapsed: " << result.time << " ms" << std::endl;
+        if (!parallelAlgorithm)
+            std::cout << "Thread setup time: " << result.setupTime << " ms" << std::endl;
+        if (job.offloadBlocks && !result.blocks.empty())
+            std::cout << "Offload device: " << offloadDeviceName() << ", blocks: " << result.blocks.back()
+                      << " of " << result.numberOfBlocks << std::endl;
+        if (!parallelAlgorithm)
+            std::cout << "Load imbalance (max/mean busy time): " << loadImbalance(result) << std::endl;
+        std::cout << (job.genericIntegrand() ? "Error (|I - exact|): " : "Error (|Pi - pi|): ")
+                  << std::abs(result.pi - result.exactValue)
+                  << std::endl;
+        if (!job.cacheFile.empty())
+            std::cout << "Cached iterations: " << result.cachedIterations << " of " << job.iterations << std::endl;
+        if (job.progressive()) {
+            std::cout << "Completed blocks: " << result.completedBlocks << " of " << result.numberOfBlocks
+                      << " Estimated error: " << result.errorEstimate << std::endl;
+        }
+        if (job.mode == SchedulingMode::WorkStealing) {
+            long long steals = 0, failedSteals = 0;
+            for (size_t i = 0; i < result.steals.size(); i++) {
+                steals += result.steals[i];
+                failedSteals += result.failedSteals[i];
+            }
+            std::cout << "Steals: " << steals << " Failed steal attempts: " << failedSteals << std::endl;
+        }
+        if (!result.placement.empty())
+            printClassThroughput(result);
+        if (options.threadStats)
+            printThreadStats(result, job.mode);
+        if (job.counters)
+            printCounters(result);
+        if (job.measureEnergy)
+            printEnergy(result);
+
+        if (options.verify)
+            verifyAgainstReference(result, options);
     }
-}
 
+    if (!options.traceFile.empty())
+        writeTrace(options.traceFile);
 
-int main() {
-    calculatePi();
-    system("pause");
+    shutdownJobs();
     return 0;
-}
\ No newline at end of file
+}
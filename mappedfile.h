@@ -0,0 +1,36 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+/*
+ * Файл, отображенный в память целиком (для кэша результатов, см. resultcache.h).
+ * Реализация выбирается при сборке по платформе:
+ *      mappedfile_win32.cpp - CreateFileMapping/MapViewOfFile;
+ *      mappedfile_posix.cpp - mmap.
+ * */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct MappedFile {
+    void *data = nullptr;
+    size_t size = 0;
+    // Дескрипторы файла и отображения (HANDLE в Win32, int в POSIX)
+    intptr_t file = -1;
+    intptr_t mapping = -1;
+};
+
+/*
+ * Открытие (или создание) файла path и отображение первых size байт.
+ * Короткий файл дополняется нулями до size.
+ * Возвращает false и выводит причину в std::cerr при ошибке.
+ * */
+bool mapFile(const std::string &path, size_t size, MappedFile &file);
+
+// Сброс измененных страниц на диск.
+void flushMappedFile(MappedFile &file);
+
+// Сброс, снятие отображения и закрытие файла.
+void unmapFile(MappedFile &file);
+
+#endif //MAPPEDFILE_H
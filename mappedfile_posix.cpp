@@ -0,0 +1,48 @@
+#include "mappedfile.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool mapFile(const std::string &path, size_t size, MappedFile &file) {
+    int descriptor = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (descriptor < 0) {
+        std::cerr << "Could not open " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    struct stat status = {};
+    if (fstat(descriptor, &status) < 0 || ((size_t) status.st_size < size && ftruncate(descriptor, (off_t) size) < 0)) {
+        std::cerr << "Could not resize " << path << ": " << std::strerror(errno) << std::endl;
+        close(descriptor);
+        return false;
+    }
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    if (data == MAP_FAILED) {
+        std::cerr << "Could not map " << path << ": " << std::strerror(errno) << std::endl;
+        close(descriptor);
+        return false;
+    }
+    file.data = data;
+    file.size = size;
+    file.file = descriptor;
+    return true;
+}
+
+void flushMappedFile(MappedFile &file) {
+    if (file.data)
+        msync(file.data, file.size, MS_SYNC);
+}
+
+void unmapFile(MappedFile &file) {
+    if (!file.data)
+        return;
+    flushMappedFile(file);
+    munmap(file.data, file.size);
+    close((int) file.file);
+    file = MappedFile();
+}
@@ -0,0 +1,51 @@
+#include "mappedfile.h"
+
+#include <iostream>
+
+#include <windows.h>
+
+bool mapFile(const std::string &path, size_t size, MappedFile &file) {
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        std::cerr << "Could not open " << path << ": " << GetLastError() << std::endl;
+        return false;
+    }
+    // Отображение размера size само увеличивает файл, новые байты - нули
+    HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READWRITE, (DWORD) ((uint64_t) size >> 32),
+                                        (DWORD) size, nullptr);
+    if (!mapping) {
+        std::cerr << "Could not map " << path << ": " << GetLastError() << std::endl;
+        CloseHandle(handle);
+        return false;
+    }
+    void *data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!data) {
+        std::cerr << "Could not map " << path << ": " << GetLastError() << std::endl;
+        CloseHandle(mapping);
+        CloseHandle(handle);
+        return false;
+    }
+    file.data = data;
+    file.size = size;
+    file.file = (intptr_t) handle;
+    file.mapping = (intptr_t) mapping;
+    return true;
+}
+
+void flushMappedFile(MappedFile &file) {
+    if (!file.data)
+        return;
+    FlushViewOfFile(file.data, file.size);
+    FlushFileBuffers((HANDLE) file.file);
+}
+
+void unmapFile(MappedFile &file) {
+    if (!file.data)
+        return;
+    flushMappedFile(file);
+    UnmapViewOfFile(file.data);
+    CloseHandle((HANDLE) file.mapping);
+    CloseHandle((HANDLE) file.file);
+    file = MappedFile();
+}
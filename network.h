@@ -0,0 +1,51 @@
+#ifndef NETWORK_H
+#define NETWORK_H
+
+/*
+ * Минимальная обертка над TCP-сокетами для распределенного режима.
+ * Реализация выбирается при сборке по платформе:
+ *      network_win32.cpp - Winsock 2;
+ *      network_posix.cpp - сокеты BSD (Linux, macOS).
+ * Протокол распределенного режима текстовый, построчный (см. distributed.h).
+ * */
+
+#include <cstdint>
+#include <string>
+
+// Дескриптор сокета (SOCKET в Winsock, int в POSIX)
+typedef intptr_t Socket;
+
+constexpr Socket NO_SOCKET = -1;
+
+// Инициализация сетевой подсистемы (WSAStartup); вызывается один раз.
+bool networkStartup();
+
+// Сокет, принимающий соединения на порту port всех интерфейсов.
+Socket listenOn(int port);
+
+/*
+ * Ожидание входящего соединения не дольше timeout мс.
+ * Возвращает false, если соединений за это время не было (или ожидание не удалось).
+ * */
+bool waitForConnection(Socket listener, int timeout);
+
+// Ожидание и прием очередного соединения.
+Socket acceptConnection(Socket listener, std::string &peerName);
+
+// Соединение с host:port.
+Socket connectTo(const std::string &host, int port);
+
+// Отправка строки целиком (с переводом строки в конце).
+bool sendLine(Socket socket, const std::string &line);
+
+/*
+ * Прием строки до перевода строки (без него).
+ * Читается по одному байту: сообщения короткие и редкие,
+ * зато на сокете не остается прочитанных, но не разобранных данных.
+ * Возвращает false при разрыве соединения.
+ * */
+bool receiveLine(Socket socket, std::string &line);
+
+void closeSocket(Socket socket);
+
+#endif //NETWORK_H
@@ -0,0 +1,126 @@
+#include "network.h"
+
+#include <cstring>
+#include <iostream>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+bool networkStartup() {
+    return true;
+}
+
+// Короткие сообщения протокола не должны ждать алгоритма Нейгла
+static void disableNagle(int socket) {
+    int flag = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+Socket listenOn(int port) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0) {
+        std::cerr << "socket failed: " << std::strerror(errno) << std::endl;
+        return NO_SOCKET;
+    }
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((uint16_t) port);
+    if (bind(listener, (sockaddr *) &address, sizeof(address)) < 0 || listen(listener, SOMAXCONN) < 0) {
+        std::cerr << "Could not listen on port " << port << ": " << std::strerror(errno) << std::endl;
+        close(listener);
+        return NO_SOCKET;
+    }
+    return listener;
+}
+
+bool waitForConnection(Socket listener, int timeout) {
+    pollfd descriptor = {(int) listener, POLLIN, 0};
+    int status = poll(&descriptor, 1, timeout);
+    if (status < 0 && errno != EINTR)
+        std::cerr << "poll failed: " << std::strerror(errno) << std::endl;
+    return status > 0;
+}
+
+Socket acceptConnection(Socket listener, std::string &peerName) {
+    sockaddr_in address = {};
+    socklen_t length = sizeof(address);
+    int connection = accept((int) listener, (sockaddr *) &address, &length);
+    if (connection < 0) {
+        std::cerr << "accept failed: " << std::strerror(errno) << std::endl;
+        return NO_SOCKET;
+    }
+    disableNagle(connection);
+
+    char host[INET_ADDRSTRLEN] = "";
+    inet_ntop(AF_INET, &address.sin_addr, host, sizeof(host));
+    peerName = std::string(host) + ":" + std::to_string(ntohs(address.sin_port));
+    return connection;
+}
+
+Socket connectTo(const std::string &host, int port) {
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *addresses;
+    int status = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses);
+    if (status != 0) {
+        std::cerr << "Could not resolve " << host << ": " << gai_strerror(status) << std::endl;
+        return NO_SOCKET;
+    }
+
+    int connection = -1;
+    for (addrinfo *address = addresses; address; address = address->ai_next) {
+        connection = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (connection < 0)
+            continue;
+        if (connect(connection, address->ai_addr, address->ai_addrlen) == 0)
+            break;
+        close(connection);
+        connection = -1;
+    }
+    freeaddrinfo(addresses);
+
+    if (connection < 0) {
+        std::cerr << "Could not connect to " << host << ":" << port << std::endl;
+        return NO_SOCKET;
+    }
+    disableNagle(connection);
+    return connection;
+}
+
+bool sendLine(Socket socket, const std::string &line) {
+    std::string data = line + "\n";
+    size_t sent = 0;
+    while (sent < data.size()) {
+        // MSG_NOSIGNAL: разрыв соединения - ошибка send, а не SIGPIPE
+        ssize_t count = send((int) socket, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (count <= 0)
+            return false;
+        sent += count;
+    }
+    return true;
+}
+
+bool receiveLine(Socket socket, std::string &line) {
+    line.clear();
+    char symbol;
+    while (recv((int) socket, &symbol, 1, 0) == 1) {
+        if (symbol == '\n')
+            return true;
+        line += symbol;
+    }
+    return false;
+}
+
+void closeSocket(Socket socket) {
+    close((int) socket);
+}
@@ -0,0 +1,125 @@
+#include "network.h"
+
+#include <iostream>
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+bool networkStartup() {
+    WSADATA data;
+    int status = WSAStartup(MAKEWORD(2, 2), &data);
+    if (status != 0) {
+        std::cerr << "WSAStartup failed: " << status << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Короткие сообщения протокола не должны ждать алгоритма Нейгла
+static void disableNagle(SOCKET socket) {
+    BOOL flag = TRUE;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char *) &flag, sizeof(flag));
+}
+
+Socket listenOn(int port) {
+    SOCKET listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener == INVALID_SOCKET) {
+        std::cerr << "socket failed: " << WSAGetLastError() << std::endl;
+        return NO_SOCKET;
+    }
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((u_short) port);
+    if (bind(listener, (sockaddr *) &address, sizeof(address)) == SOCKET_ERROR
+        || listen(listener, SOMAXCONN) == SOCKET_ERROR) {
+        std::cerr << "Could not listen on port " << port << ": " << WSAGetLastError() << std::endl;
+        closesocket(listener);
+        return NO_SOCKET;
+    }
+    return (Socket) listener;
+}
+
+bool waitForConnection(Socket listener, int timeout) {
+    WSAPOLLFD descriptor = {(SOCKET) listener, POLLRDNORM, 0};
+    int status = WSAPoll(&descriptor, 1, timeout);
+    if (status == SOCKET_ERROR)
+        std::cerr << "WSAPoll failed: " << WSAGetLastError() << std::endl;
+    return status > 0;
+}
+
+Socket acceptConnection(Socket listener, std::string &peerName) {
+    sockaddr_in address = {};
+    int length = sizeof(address);
+    SOCKET connection = accept((SOCKET) listener, (sockaddr *) &address, &length);
+    if (connection == INVALID_SOCKET) {
+        std::cerr << "accept failed: " << WSAGetLastError() << std::endl;
+        return NO_SOCKET;
+    }
+    disableNagle(connection);
+
+    char host[INET_ADDRSTRLEN] = "";
+    inet_ntop(AF_INET, &address.sin_addr, host, sizeof(host));
+    peerName = std::string(host) + ":" + std::to_string(ntohs(address.sin_port));
+    return (Socket) connection;
+}
+
+Socket connectTo(const std::string &host, int port) {
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    addrinfo *addresses;
+    int status = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses);
+    if (status != 0) {
+        std::cerr << "Could not resolve " << host << ": " << status << std::endl;
+        return NO_SOCKET;
+    }
+
+    SOCKET connection = INVALID_SOCKET;
+    for (addrinfo *address = addresses; address; address = address->ai_next) {
+        connection = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (connection == INVALID_SOCKET)
+            continue;
+        if (connect(connection, address->ai_addr, (int) address->ai_addrlen) == 0)
+            break;
+        closesocket(connection);
+        connection = INVALID_SOCKET;
+    }
+    freeaddrinfo(addresses);
+
+    if (connection == INVALID_SOCKET) {
+        std::cerr << "Could not connect to " << host << ":" << port << std::endl;
+        return NO_SOCKET;
+    }
+    disableNagle(connection);
+    return (Socket) connection;
+}
+
+bool sendLine(Socket socket, const std::string &line) {
+    std::string data = line + "\n";
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int count = send((SOCKET) socket, data.data() + sent, (int) (data.size() - sent), 0);
+        if (count == SOCKET_ERROR || count == 0)
+            return false;
+        sent += count;
+    }
+    return true;
+}
+
+bool receiveLine(Socket socket, std::string &line) {
+    line.clear();
+    char symbol;
+    while (recv((SOCKET) socket, &symbol, 1, 0) == 1) {
+        if (symbol == '\n')
+            return true;
+        line += symbol;
+    }
+    return false;
+}
+
+void closeSocket(Socket socket) {
+    closesocket((SOCKET) socket);
+}
@@ -0,0 +1,52 @@
+#include "offload.h"
+
+#ifdef PI_OFFLOAD
+#include <omp.h>
+
+bool offloadSupported() {
+    return true;
+}
+
+bool offloadDeviceAvailable() {
+    return omp_get_num_devices() > 0;
+}
+
+const char *offloadDeviceName() {
+    return offloadDeviceAvailable() ? "OpenMP target device" : "OpenMP host fallback (no device)";
+}
+
+double offloadRange(long long first, long long last, long long n) {
+    double sum = 0;
+    const double h = 1.0 / n;
+    /*
+     * Каждая команда (блок потоков GPU) суммирует свою часть итераций,
+     * суммы потоков и команд складываются деревом на устройстве.
+     * Данных на устройство не передается: итерации задаются номерами.
+     * */
+#pragma omp target teams distribute parallel for simd reduction(+:sum) map(tofrom:sum)
+    for (long long i = first; i < last; i++) {
+        double x = (i + 0.5) * h;
+        sum += 4 / (1 + x * x);
+    }
+    return sum;
+}
+
+#else
+
+bool offloadSupported() {
+    return false;
+}
+
+bool offloadDeviceAvailable() {
+    return false;
+}
+
+const char *offloadDeviceName() {
+    return "not built (ENABLE_OFFLOAD=OFF)";
+}
+
+double offloadRange(long long, long long, long long) {
+    return 0;
+}
+
+#endif
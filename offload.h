@@ -0,0 +1,34 @@
+#ifndef OFFLOAD_H
+#define OFFLOAD_H
+
+/*
+ * Расчет блоков на ускорителе (GPU) через OpenMP target offload.
+ * Собирается при ENABLE_OFFLOAD (определяет PI_OFFLOAD), компилятор
+ * должен поддерживать выгрузку на нужное устройство (например,
+ * GCC с -foffload=nvptx-none или -foffload=amdgcn-amdhsa, Clang с -fopenmp-targets).
+ * Без ENABLE_OFFLOAD функции ниже есть, но offloadSupported() == false.
+ *
+ * Ускоритель обслуживается отдельным потоком пула (см. calculateOffload в main.cpp):
+ * он забирает из общего счетчика блоков сразу несколько подряд идущих блоков
+ * и отправляет их одним запуском, а потоки процессора забирают остальные блоки как обычно.
+ * */
+
+// Собрана ли программа с поддержкой выгрузки
+bool offloadSupported();
+
+// Есть ли доступное устройство; без него target-регионы выполняются на процессоре
+bool offloadDeviceAvailable();
+
+// Описание устройства для вывода
+const char *offloadDeviceName();
+
+/*
+ * Сумма 4 / (1 + x^2) в средних точках итераций [first, last) из n
+ * (как у ядер из kernels.h, до нормировки).
+ * Итерации распределяются по командам и потокам устройства,
+ * частичные суммы складываются на устройстве (reduction), на процессор
+ * возвращается одно число.
+ * */
+double offloadRange(long long first, long long last, long long n);
+
+#endif //OFFLOAD_H
@@ -0,0 +1,116 @@
+#include "parallelalgorithm.h"
+
+#include <cstddef>
+#include <execution>
+#include <iterator>
+#include <numeric>
+
+#include "integrands.h"
+
+/*
+ * Итератор по числам first, first + 1, ...
+ * std::views::iota не подходит: параллельным алгоритмам нужны
+ * итераторы с категорией random_access_iterator_tag, а у iota_view
+ * категория (C++17) - input_iterator_tag, и алгоритм выполнился бы последовательно.
+ * */
+class CountingIterator {
+public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef long long value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const long long *pointer;
+    typedef long long reference;
+
+    CountingIterator() = default;
+
+    explicit CountingIterator(long long value) : value(value) {}
+
+    long long operator*() const {
+        return value;
+    }
+
+    long long operator[](difference_type offset) const {
+        return value + offset;
+    }
+
+    CountingIterator &operator++() {
+        value++;
+        return *this;
+    }
+
+    CountingIterator operator++(int) {
+        return CountingIterator(value++);
+    }
+
+    CountingIterator &operator--() {
+        value--;
+        return *this;
+    }
+
+    CountingIterator operator--(int) {
+        return CountingIterator(value--);
+    }
+
+    CountingIterator &operator+=(difference_type offset) {
+        value += offset;
+        return *this;
+    }
+
+    CountingIterator &operator-=(difference_type offset) {
+        value -= offset;
+        return *this;
+    }
+
+    friend CountingIterator operator+(CountingIterator iterator, difference_type offset) {
+        return CountingIterator(iterator.value + offset);
+    }
+
+    friend CountingIterator operator+(difference_type offset, CountingIterator iterator) {
+        return CountingIterator(iterator.value + offset);
+    }
+
+    friend CountingIterator operator-(CountingIterator iterator, difference_type offset) {
+        return CountingIterator(iterator.value - offset);
+    }
+
+    friend difference_type operator-(CountingIterator left, CountingIterator right) {
+        return left.value - right.value;
+    }
+
+    friend auto operator<=>(CountingIterator left, CountingIterator right) = default;
+
+private:
+    long long value = 0;
+};
+
+template<class Integrand>
+static double transformReduce(long long first, long long last, long long n) {
+    const double h = (Integrand::upper - Integrand::lower) / n;
+    return std::transform_reduce(std::execution::par_unseq, CountingIterator(first), CountingIterator(last), 0.0,
+                                 std::plus<>(), [h](long long i) {
+                const Integrand f;
+                return f(Integrand::lower + (i + 0.5) * h);
+            });
+}
+
+bool parallelAlgorithmSum(const std::string &integrand, long long first, long long last, long long n, double &sum) {
+    if (integrand == "pi")
+        sum = transformReduce<PiIntegrand>(first, last, n);
+    else if (integrand == "sin")
+        sum = transformReduce<SinIntegrand>(first, last, n);
+    else if (integrand == "gauss")
+        sum = transformReduce<GaussIntegrand>(first, last, n);
+    else
+        return false;
+    return true;
+}
+
+const char *parallelAlgorithmName() {
+#if defined(_PSTL_PAR_BACKEND_TBB)
+    return "std::execution::par_unseq (TBB)";
+#elif defined(_PSTL_PAR_BACKEND_SERIAL)
+    return "std::execution::par_unseq (serial fallback, no TBB)";
+#else
+    return "std::execution::par_unseq";
+#endif
+}
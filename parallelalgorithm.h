@@ -0,0 +1,25 @@
+#ifndef PARALLELALGORITHM_H
+#define PARALLELALGORITHM_H
+
+#include <string>
+
+/*
+ * Расчет стандартным параллельным алгоритмом:
+ * std::transform_reduce(std::execution::par_unseq, ...) по номерам итераций,
+ * без собственного пула потоков, блоков и ядер из kernels.h.
+ * Число потоков и векторизацию выбирает реализация стандартной библиотеки
+ * (libstdc++ выполняет параллельные алгоритмы через TBB, MSVC - через свой пул).
+ * Служит точкой отсчета для собственного планирования в calculatePi.
+ * */
+
+/*
+ * Сумма значений функции integrand (pi, sin, gauss) в средних точках
+ * итераций [first, last) из n, до нормировки (как у ядер).
+ * Возвращает false, если функция неизвестна.
+ * */
+bool parallelAlgorithmSum(const std::string &integrand, long long first, long long last, long long n, double &sum);
+
+// Описание исполнения для вывода: политика и, если известна, реализация
+const char *parallelAlgorithmName();
+
+#endif //PARALLELALGORITHM_H
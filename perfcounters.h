@@ -0,0 +1,42 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+/*
+ * Счетчики процессора по потокам (режим --counters): такты, инструкции,
+ * промахи кэша и переключения контекста потока за время расчета.
+ * Реализация выбирается при сборке по платформе:
+ *      perfcounters_posix.cpp - perf_event_open и getrusage(RUSAGE_THREAD) на Linux,
+ *      на остальных POSIX-системах счетчики недоступны;
+ *      perfcounters_win32.cpp - QueryThreadCycleTime (такты),
+ *      остальные счетчики недоступны.
+ * Счетчики открываются один раз на поток (пул потоков переживает расчеты)
+ * и считают только пользовательский режим, чтобы не требовать прав
+ * при kernel.perf_event_paranoid = 2.
+ * */
+
+// Показания счетчиков, -1 - счетчик недоступен
+struct PerfCounters {
+    long long cycles = -1;
+    long long instructions = -1;
+    long long cacheMisses = -1;
+    long long contextSwitches = -1;
+};
+
+// Текущие показания счетчиков вызывающего потока (при первом вызове счетчики открываются).
+PerfCounters readThreadCounters();
+
+// Показания за интервал: after - before (недоступные счетчики остаются -1).
+inline PerfCounters counterDelta(const PerfCounters &before, const PerfCounters &after) {
+    auto delta = [](long long start, long long end) { return start < 0 || end < 0 ? -1 : end - start; };
+    PerfCounters counters;
+    counters.cycles = delta(before.cycles, after.cycles);
+    counters.instructions = delta(before.instructions, after.instructions);
+    counters.cacheMisses = delta(before.cacheMisses, after.cacheMisses);
+    counters.contextSwitches = delta(before.contextSwitches, after.contextSwitches);
+    return counters;
+}
+
+// Источник счетчиков для вывода (perf_event_open, QueryThreadCycleTime, none).
+const char *perfCountersName();
+
+#endif //PERFCOUNTERS_H
@@ -0,0 +1,84 @@
+#include "perfcounters.h"
+
+#ifdef __linux__
+
+#include <cstdint>
+#include <initializer_list>
+
+#include <linux/perf_event.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Дескрипторы счетчиков потока: такты, инструкции, промахи кэша
+struct ThreadCounterFiles {
+    int cycles = -1;
+    int instructions = -1;
+    int cacheMisses = -1;
+    bool opened = false;
+
+    ~ThreadCounterFiles() {
+        for (int file : {cycles, instructions, cacheMisses}) {
+            if (file >= 0)
+                close(file);
+        }
+    }
+};
+
+static thread_local ThreadCounterFiles threadFiles;
+
+// Аппаратный счетчик вызывающего потока на любом процессоре; -1, если PMU недоступен (например, в ВМ)
+static int openCounter(uint64_t config) {
+    perf_event_attr attributes = {};
+    attributes.size = sizeof(attributes);
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.config = config;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+}
+
+static long long readCounter(int file) {
+    long long value;
+    if (file < 0 || read(file, &value, sizeof(value)) != sizeof(value))
+        return -1;
+    return value;
+}
+
+PerfCounters readThreadCounters() {
+    if (!threadFiles.opened) {
+        threadFiles.cycles = openCounter(PERF_COUNT_HW_CPU_CYCLES);
+        threadFiles.instructions = openCounter(PERF_COUNT_HW_INSTRUCTIONS);
+        threadFiles.cacheMisses = openCounter(PERF_COUNT_HW_CACHE_MISSES);
+        threadFiles.opened = true;
+    }
+    PerfCounters counters;
+    counters.cycles = readCounter(threadFiles.cycles);
+    counters.instructions = readCounter(threadFiles.instructions);
+    counters.cacheMisses = readCounter(threadFiles.cacheMisses);
+    /*
+     * Программный счетчик переключений контекста perf считает в ядре
+     * и с exclude_kernel всегда дает 0, поэтому переключения
+     * (добровольные - ожидание, и вытеснения) берутся из getrusage.
+     * */
+    rusage usage = {};
+    if (getrusage(RUSAGE_THREAD, &usage) == 0)
+        counters.contextSwitches = usage.ru_nvcsw + usage.ru_nivcsw;
+    return counters;
+}
+
+const char *perfCountersName() {
+    return "perf_event_open";
+}
+
+#else
+
+PerfCounters readThreadCounters() {
+    return {};
+}
+
+const char *perfCountersName() {
+    return "none";
+}
+
+#endif
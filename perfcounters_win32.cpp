@@ -0,0 +1,22 @@
+#include "perfcounters.h"
+
+#include <windows.h>
+
+/*
+ * Такты потока дает QueryThreadCycleTime (счетчик тактов на опорной частоте).
+ * Инструкции и промахи кэша по потокам доступны только через трассировку ETW
+ * с сессией ядра (права администратора), а счетчики PDH - это частоты
+ * по экземплярам потоков, а не показания за интервал, поэтому здесь
+ * они не собираются.
+ * */
+PerfCounters readThreadCounters() {
+    PerfCounters counters;
+    ULONG64 cycles;
+    if (QueryThreadCycleTime(GetCurrentThread(), &cycles))
+        counters.cycles = (long long) cycles;
+    return counters;
+}
+
+const char *perfCountersName() {
+    return "QueryThreadCycleTime";
+}
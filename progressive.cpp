@@ -0,0 +1,140 @@
+#include "progressive.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <utility>
+
+std::vector<long long> bisectionOrder(long long numberOfBlocks) {
+    std::vector<long long> order;
+    order.reserve(numberOfBlocks);
+    if (numberOfBlocks < 1)
+        return order;
+
+    order.push_back(0);
+    if (numberOfBlocks == 1)
+        return order;
+    order.push_back(numberOfBlocks - 1);
+
+    // Отрезки (left, right), концы которых уже в порядке обхода
+    std::queue<std::pair<long long, long long>> segments;
+    segments.emplace(0, numberOfBlocks - 1);
+    while (!segments.empty()) {
+        auto [left, right] = segments.front();
+        segments.pop();
+        if (right - left < 2)
+            continue;
+        long long middle = left + (right - left) / 2;
+        order.push_back(middle);
+        segments.emplace(left, middle);
+        segments.emplace(middle, right);
+    }
+    return order;
+}
+
+void ProgressiveEstimate::reset(long long numberOfIterations, long long size) {
+    iterations = numberOfIterations;
+    blockSize = size;
+    means.clear();
+    knownSum = 0;
+    gapSum = 0;
+    gapError = 0;
+}
+
+long long ProgressiveEstimate::blockStart(long long block) const {
+    return block * blockSize;
+}
+
+long long ProgressiveEstimate::blockEnd(long long block) const {
+    return std::min((block + 1) * blockSize, iterations);
+}
+
+double ProgressiveEstimate::blockCenter(BlockIterator block) const {
+    return (blockStart(block->first) + blockEnd(block->first)) / 2.0;
+}
+
+double ProgressiveEstimate::gapEstimate(BlockIterator left, BlockIterator right) const {
+    bool hasLeft = left != means.end();
+    bool hasRight = right != means.end();
+    long long gapStart = hasLeft ? blockEnd(left->first) : 0;
+    long long gapEnd = hasRight ? blockStart(right->first) : iterations;
+    double length = (double) (gapEnd - gapStart);
+
+    if (hasLeft && hasRight) {
+        // Интеграл прямой через центры блоков по промежутку - значение в его середине на длину
+        double slope = (right->second - left->second) / (blockCenter(right) - blockCenter(left));
+        return length * (left->second + slope * ((gapStart + gapEnd) / 2.0 - blockCenter(left)));
+    }
+    if (hasLeft)
+        return length * left->second;
+    if (hasRight)
+        return length * right->second;
+    return 0;
+}
+
+double ProgressiveEstimate::secondDerivative(BlockIterator first, BlockIterator second,
+                                             BlockIterator third) const {
+    double leftSlope = (second->second - first->second) / (blockCenter(second) - blockCenter(first));
+    double rightSlope = (third->second - second->second) / (blockCenter(third) - blockCenter(second));
+    return 2 * (rightSlope - leftSlope) / (blockCenter(third) - blockCenter(first));
+}
+
+double ProgressiveEstimate::gapErrorAfter(BlockIterator left) const {
+    BlockIterator right = left == means.end() ? means.begin() : std::next(left);
+    if (left == means.end() || right == means.end())
+        return std::abs(gapEstimate(left, right));
+
+    double length = (double) (blockStart(right->first) - blockEnd(left->first));
+    if (length == 0)
+        return 0;
+
+    // Кривизна по тройкам готовых блоков слева и справа от промежутка
+    double curvature = -1;
+    if (left != means.begin())
+        curvature = std::abs(secondDerivative(std::prev(left), left, right));
+    if (std::next(right) != means.end())
+        curvature = std::max(curvature, std::abs(secondDerivative(left, right, std::next(right))));
+    if (curvature < 0)
+        return length * std::abs(right->second - left->second) / 2;
+
+    double distance = blockCenter(right) - blockCenter(left);
+    return curvature * length * distance * distance / 8;
+}
+
+void ProgressiveEstimate::addBlock(long long block, double sum) {
+    BlockIterator right = means.lower_bound(block);
+    BlockIterator left = right == means.begin() ? means.end() : BlockIterator(std::prev(right));
+
+    /*
+     * Погрешность зависит от двух готовых блоков с каждой стороны промежутка,
+     * поэтому пересчитываются промежутки после left (разбиваемый),
+     * после блока перед left и после right.
+     * */
+    BlockIterator beforeLeft = left == means.end() || left == means.begin() ? means.end() : std::prev(left);
+    auto affectedError = [&](BlockIterator inserted) {
+        double error = 0;
+        if (left != means.end() && beforeLeft != means.end())
+            error += gapErrorAfter(beforeLeft);
+        error += gapErrorAfter(left);
+        if (inserted != means.end())
+            error += gapErrorAfter(inserted);
+        if (right != means.end())
+            error += gapErrorAfter(right);
+        return error;
+    };
+
+    gapSum -= gapEstimate(left, right);
+    gapError -= affectedError(means.end());
+
+    BlockIterator inserted = means.emplace_hint(right, block, sum / (double) (blockEnd(block) - blockStart(block)));
+    knownSum += sum;
+
+    gapSum += gapEstimate(left, inserted) + gapEstimate(inserted, right);
+    gapError += affectedError(inserted);
+
+    if (completedBlocks() == (iterations + blockSize - 1) / blockSize) {
+        // Все блоки готовы - убираем накопленную погрешность вычитаний
+        gapSum = 0;
+        gapError = 0;
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef PROGRESSIVE_H
+#define PROGRESSIVE_H
+
+#include <map>
+#include <vector>
+
+/*
+ * Порядок обхода блоков для прогрессивного расчета:
+ * первый и последний блоки, затем середина, затем середины
+ * получившихся половин и т.д. (деление отрезков пополам в ширину).
+ * Так готовые блоки в любой момент равномерно покрывают отрезок
+ * интегрирования, и по ним можно оценить весь интеграл.
+ * */
+std::vector<long long> bisectionOrder(long long numberOfBlocks);
+
+/*
+ * Оценка суммы ядра по всем итерациям по уже обсчитанным блокам.
+ * Сумма необсчитанной части между двумя готовыми блоками оценивается
+ * линейной интерполяцией средних значений на итерацию в этих блоках.
+ * Погрешность интерполяции на промежутке длины L между центрами блоков,
+ * отстоящими на D, - примерно |f''| * L * D^2 / 8; f'' оценивается второй
+ * разделенной разностью по соседним готовым блокам. Пока соседей не хватает,
+ * погрешность - половина разности средних на L (оценка первого порядка).
+ * Промежуток у края отрезка с одним готовым соседом оценивается по нему,
+ * а погрешность считается равной самой оценке (о функции там ничего не известно).
+ * Добавление блока меняет оценку только в его промежутке,
+ * а погрешность - еще в двух соседних: O(log числа блоков).
+ * */
+class ProgressiveEstimate {
+public:
+    void reset(long long numberOfIterations, long long blockSize);
+
+    void addBlock(long long block, double sum);
+
+    long long completedBlocks() const {
+        return (long long) means.size();
+    }
+
+    double sum() const {
+        return knownSum + gapSum;
+    }
+
+    double errorBound() const {
+        return gapError;
+    }
+
+private:
+    long long blockStart(long long block) const;
+    long long blockEnd(long long block) const;
+
+    typedef std::map<long long, double>::const_iterator BlockIterator;
+
+    double blockCenter(BlockIterator block) const;
+
+    // Оценка суммы промежутка между готовыми блоками left и right (end() - нет соседа)
+    double gapEstimate(BlockIterator left, BlockIterator right) const;
+
+    // Погрешность оценки промежутка после готового блока left (end() - промежуток в начале)
+    double gapErrorAfter(BlockIterator left) const;
+
+    // Вторая производная среднего по трем готовым блокам
+    double secondDerivative(BlockIterator first, BlockIterator second, BlockIterator third) const;
+
+    long long iterations = 0;
+    long long blockSize = 1;
+    // Среднее значение на итерацию для каждого готового блока
+    std::map<long long, double> means;
+    double knownSum = 0;
+    double gapSum = 0;
+    double gapError = 0;
+};
+
+#endif //PROGRESSIVE_H
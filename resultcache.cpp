@@ -0,0 +1,298 @@
+#include "resultcache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "energy.h"
+#include "mappedfile.h"
+
+// Вид узлов суммы в кэше
+enum class CacheNodes : int32_t {
+    Midpoint,
+    Trapezoid
+};
+
+// Ключ записи; все поля явные, без выравнивающих промежутков, чтобы ключи сравнивались побайтно
+struct CacheKey {
+    char integrand[16];
+    // Ядро, которым считаются узлы (KernelInfo::name): auto на разных машинах - разные ядра
+    char kernel[32];
+    int32_t nodes;
+    int32_t precision;
+    int32_t accumulation;
+    int32_t reduction;
+    int64_t blockSize;
+    int64_t iterations;
+};
+
+struct CacheEntry {
+    CacheKey key;
+    double sum;
+    // 0 - свободная запись
+    int64_t used;
+};
+
+struct CacheHeader {
+    char magic[8];
+    int64_t capacity;
+};
+
+static constexpr char CACHE_MAGIC[8] = {'P', 'I', 'C', 'A', 'C', 'H', 'E', '2'};
+// Записей в файле (около 220 КБ)
+static constexpr int64_t CACHE_CAPACITY = 4096;
+/*
+ * Открытая адресация: запись ищется в CACHE_PROBES слотах подряд от хэша ключа.
+ * Если все они заняты другими ключами, новая запись вытесняет последнюю из них.
+ * */
+static constexpr int CACHE_PROBES = 16;
+
+static MappedFile cacheFile;
+static std::string cachePath;
+static CacheEntry *entries = nullptr;
+
+// Состояние расчета через кэш: статистика выполненных расчетов и число итераций из кэша
+struct CachedRun {
+    const JobConfig &config;
+    const std::atomic<bool> &cancelled;
+    CalculationResult result;
+    bool computed;
+    long long cachedIterations;
+};
+
+static bool openResultCache(const std::string &path) {
+    if (entries && cachePath == path)
+        return true;
+    closeResultCache();
+
+    // Непустой файл другого формата не затираем
+    std::error_code error;
+    if (std::filesystem::file_size(path, error) > 0 && !error) {
+        CacheHeader header = {};
+        std::ifstream input(path, std::ios::binary);
+        input.read((char *) &header, sizeof(header));
+        if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.capacity != CACHE_CAPACITY) {
+            std::cerr << path << " is not a result cache, calculating without it" << std::endl;
+            return false;
+        }
+    }
+
+    if (!mapFile(path, sizeof(CacheHeader) + CACHE_CAPACITY * sizeof(CacheEntry), cacheFile))
+        return false;
+    auto *header = (CacheHeader *) cacheFile.data;
+    // Новый файл заполнен нулями, т.е. все записи свободны
+    if (header->capacity == 0) {
+        std::memcpy(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        header->capacity = CACHE_CAPACITY;
+    }
+    entries = (CacheEntry *) (header + 1);
+    cachePath = path;
+    return true;
+}
+
+void closeResultCache() {
+    unmapFile(cacheFile);
+    entries = nullptr;
+    cachePath.clear();
+}
+
+/*
+ * Ядро, размер блока и способ редукции определяют порядок сложения,
+ * т.е. последние биты суммы, поэтому тоже входят в ключ.
+ * Ядро выбирается так же, как в prepareJob для расчета этих узлов.
+ * */
+static CacheKey makeKey(const JobConfig &config, CacheNodes nodes, long long n) {
+    KernelInfo kernel = {"", nullptr};
+    double exactValue;
+    findKernel(config.kernel, config.precision, kernel, config.accumulation);
+    if (config.integrand != "pi" || nodes != CacheNodes::Midpoint)
+        findIntegrand(config.integrand, nodes == CacheNodes::Midpoint ? QuadratureRule::Midpoint
+                                                                      : QuadratureRule::Trapezoid, kernel, exactValue);
+
+    CacheKey key = {};
+    std::strncpy(key.integrand, config.integrand.c_str(), sizeof(key.integrand) - 1);
+    std::strncpy(key.kernel, kernel.name, sizeof(key.kernel) - 1);
+    key.nodes = (int32_t) nodes;
+    // Точность и накопление влияют только на ядра pi со средними точками, остальные ядра обобщенные
+    if (config.integrand == "pi" && nodes == CacheNodes::Midpoint) {
+        key.precision = (int32_t) config.precision;
+        key.accumulation = (int32_t) config.accumulation;
+    }
+    key.reduction = (int32_t) config.reduction;
+    key.blockSize = config.blockSize;
+    key.iterations = n;
+    return key;
+}
+
+// FNV-1a по байтам ключа
+static uint64_t hashKey(const CacheKey &key) {
+    const auto *bytes = (const unsigned char *) &key;
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < sizeof(key); i++)
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    return hash;
+}
+
+static bool lookup(const CacheKey &key, double &sum) {
+    uint64_t slot = hashKey(key);
+    for (int probe = 0; probe < CACHE_PROBES; probe++) {
+        const CacheEntry &entry = entries[(slot + probe) % CACHE_CAPACITY];
+        // Записи не удаляются, поэтому свободный слот завершает цепочку
+        if (!entry.used)
+            return false;
+        if (std::memcmp(&entry.key, &key, sizeof(key)) == 0) {
+            sum = entry.sum;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void store(const CacheKey &key, double sum) {
+    uint64_t slot = hashKey(key);
+    CacheEntry *target = &entries[(slot + CACHE_PROBES - 1) % CACHE_CAPACITY];
+    for (int probe = 0; probe < CACHE_PROBES; probe++) {
+        CacheEntry &entry = entries[(slot + probe) % CACHE_CAPACITY];
+        if (!entry.used || std::memcmp(&entry.key, &key, sizeof(key)) == 0) {
+            target = &entry;
+            break;
+        }
+    }
+    // Запись помечается занятой последней: оборванная запись остается свободной
+    target->used = 0;
+    target->key = key;
+    target->sum = sum;
+    target->used = 1;
+}
+
+// T_n только из кэша: запись целиком или T_(n/2) + M_(n/2) (рекурсивно)
+static bool cachedTrapezoid(const JobConfig &config, long long n, double &sum) {
+    if (lookup(makeKey(config, CacheNodes::Trapezoid, n), sum))
+        return true;
+    double trapezoid, midpoint;
+    if (n % 2 || !lookup(makeKey(config, CacheNodes::Midpoint, n / 2), midpoint)
+        || !cachedTrapezoid(config, n / 2, trapezoid))
+        return false;
+    sum = trapezoid + midpoint;
+    store(makeKey(config, CacheNodes::Trapezoid, n), sum);
+    return true;
+}
+
+// Статистика потоков складывается по всем расчетам задания (число потоков у них одно)
+static void mergeResult(CachedRun &run, const CalculationResult &result) {
+    if (!run.computed) {
+        run.result = result;
+        run.computed = true;
+        return;
+    }
+    CalculationResult &total = run.result;
+    total.setupTime += result.setupTime;
+    total.reductionTime += result.reductionTime;
+    total.numberOfBlocks += result.numberOfBlocks;
+    total.completedBlocks += result.completedBlocks;
+    total.specialized = total.specialized || result.specialized;
+    total.cancelled = total.cancelled || result.cancelled;
+    total.priorityFailed = total.priorityFailed || result.priorityFailed;
+    for (int thread : result.failedPins) {
+        if (std::find(total.failedPins.begin(), total.failedPins.end(), thread) == total.failedPins.end())
+            total.failedPins.push_back(thread);
+    }
+    total.energy = total.energy < 0 || result.energy < 0 ? -1 : total.energy + result.energy;
+    for (size_t i = 0; i < std::min(total.busyTime.size(), result.busyTime.size()); i++) {
+        total.busyTime[i] += result.busyTime[i];
+        total.blocks[i] += result.blocks[i];
+        total.steals[i] += result.steals[i];
+        total.failedSteals[i] += result.failedSteals[i];
+        total.iterations[i] += result.iterations[i];
+    }
+    auto add = [](long long &total, long long value) { total = total < 0 || value < 0 ? -1 : total + value; };
+    for (size_t i = 0; i < std::min(total.counters.size(), result.counters.size()); i++) {
+        add(total.counters[i].cycles, result.counters[i].cycles);
+        add(total.counters[i].instructions, result.counters[i].instructions);
+        add(total.counters[i].cacheMisses, result.counters[i].cacheMisses);
+        add(total.counters[i].contextSwitches, result.counters[i].contextSwitches);
+    }
+}
+
+// Расчет суммы по узлам nodes сетки из n отрезков и запись ее в кэш
+static double computeNodes(CachedRun &run, CacheNodes nodes, long long n) {
+    JobConfig config = run.config;
+    config.rule = nodes == CacheNodes::Midpoint ? QuadratureRule::Midpoint : QuadratureRule::Trapezoid;
+    config.iterations = n;
+    CalculationResult result = runJob(config, run.cancelled);
+    mergeResult(run, result);
+    if (!result.cancelled)
+        store(makeKey(config, nodes, n), result.sum);
+    return result.sum;
+}
+
+// Сумма по узлам nodes сетки из n отрезков: из кэша, по частям или расчетом
+static double nodeSum(CachedRun &run, CacheNodes nodes, long long n) {
+    double sum;
+    if (nodes == CacheNodes::Midpoint) {
+        if (lookup(makeKey(run.config, nodes, n), sum)) {
+            run.cachedIterations += n;
+            return sum;
+        }
+        return computeNodes(run, nodes, n);
+    }
+
+    if (cachedTrapezoid(run.config, n, sum)) {
+        run.cachedIterations += n;
+        return sum;
+    }
+    // Если есть половина узлов T_n = T_(n/2) + M_(n/2), считается только другая половина
+    double half;
+    if (n % 2 == 0 && (lookup(makeKey(run.config, CacheNodes::Midpoint, n / 2), half)
+                       || cachedTrapezoid(run.config, n / 2, half))) {
+        sum = nodeSum(run, CacheNodes::Trapezoid, n / 2) + nodeSum(run, CacheNodes::Midpoint, n / 2);
+        if (!run.result.cancelled)
+            store(makeKey(run.config, CacheNodes::Trapezoid, n), sum);
+        return sum;
+    }
+    return computeNodes(run, nodes, n);
+}
+
+CalculationResult runCachedJob(const JobConfig &config, const std::atomic<bool> &cancelled) {
+    KernelInfo kernel;
+    double exactValue;
+    prepareJob(config, kernel, exactValue);
+    if (!openResultCache(config.cacheFile))
+        return runJob(config, cancelled);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    CachedRun run = {config, cancelled, {}, false, 0};
+    run.result.blockSize = config.blockSize;
+    // Если все взято из кэша, энергия на расчет не тратилась
+    run.result.energy = config.measureEnergy && !readPackageEnergy().empty() ? 0 : -1;
+
+    long long n = config.iterations;
+    double sum = 0;
+    switch (config.rule) {
+        case QuadratureRule::Midpoint:
+            sum = nodeSum(run, CacheNodes::Midpoint, n);
+            break;
+        case QuadratureRule::Trapezoid:
+            sum = nodeSum(run, CacheNodes::Trapezoid, n);
+            break;
+        case QuadratureRule::Simpson:
+            // Симпсон на n отрезках (n четное) - узлы трапеций и средние точки сетки n / 2
+            sum = 2 * nodeSum(run, CacheNodes::Trapezoid, n / 2) + 4 * nodeSum(run, CacheNodes::Midpoint, n / 2);
+            break;
+    }
+
+    CalculationResult &result = run.result;
+    result.sum = sum;
+    result.pi = kernel.normalize(sum, n);
+    result.time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start)
+            .count();
+    result.kernel = kernel.name;
+    result.exactValue = exactValue;
+    result.errorEstimate = 0;
+    result.cachedIterations = run.cachedIterations;
+    return result;
+}
@@ -0,0 +1,38 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+/*
+ * Постоянный кэш результатов в файле, отображенном в память (см. mappedfile.h).
+ * В кэше хранятся ненормированные суммы ядра по узлам двух видов:
+ *      M_N - средние точки отрезков: f(a + 0.5 h) + ... + f(b - 0.5 h);
+ *      T_N - узлы формулы трапеций: f(a) / 2 + f(a + h) + ... + f(b) / 2,
+ * ключ - функция, вид узлов, N, ядро, размер блока и способ редукции
+ * (от них зависят последние биты суммы), а для ядер pi из kernels.h
+ * также точность и способ накопления.
+ * Повторный запрос с теми же параметрами возвращается из кэша без расчета.
+ * Узлы сетки из 2N отрезков - это узлы сетки из N отрезков и средние точки
+ * ее отрезков, поэтому
+ *      T_2N = T_N + M_N,
+ *      S_2N = 2 T_N + 4 M_N (сумма формулы Симпсона),
+ * и при удвоении N для трапеций и Симпсона считаются только недостающие точки.
+ * Для средних точек такого соотношения нет (узлы M_2N - четверти отрезков сетки N),
+ * они берутся из кэша только при совпадении N.
+ * Файл не защищен от одновременной записи несколькими процессами.
+ * */
+
+#include <atomic>
+
+#include "engine.h"
+
+/*
+ * Расчет через кэш в файле config.cacheFile (параметры уже проверены prepareJob).
+ * Недостающие суммы считаются runJob и записываются в кэш,
+ * если расчет не отменен. CalculationResult::cachedIterations - сколько
+ * итераций взято из кэша. Если файл не удалось открыть, расчет идет без кэша.
+ * */
+CalculationResult runCachedJob(const JobConfig &config, const std::atomic<bool> &cancelled);
+
+// Сброс на диск и закрытие файла кэша.
+void closeResultCache();
+
+#endif //RESULTCACHE_H
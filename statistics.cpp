@@ -0,0 +1,27 @@
+#include "statistics.h"
+
+#include <algorithm>
+#include <cmath>
+
+SampleSummary summarize(std::vector<double> samples) {
+    if (samples.empty())
+        return {0, 0, 0, 0, 0};
+
+    std::sort(samples.begin(), samples.end());
+    size_t count = samples.size();
+
+    double mean = 0;
+    for (double sample : samples)
+        mean += sample;
+    mean /= count;
+
+    double squares = 0;
+    for (double sample : samples)
+        squares += (sample - mean) * (sample - mean);
+    double stddev = count > 1 ? std::sqrt(squares / (count - 1)) : 0;
+
+    double median = count % 2 ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+    size_t p95Rank = (size_t) std::ceil(0.95 * count);
+
+    return {samples.front(), median, samples[std::max<size_t>(p95Rank, 1) - 1], mean, stddev};
+}
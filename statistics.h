@@ -0,0 +1,19 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <vector>
+
+// Сводная статистика по серии замеров
+struct SampleSummary {
+    double min;
+    double median;
+    // 95-й перцентиль (по ближайшему рангу)
+    double p95;
+    double mean;
+    // Выборочное стандартное отклонение
+    double stddev;
+};
+
+SampleSummary summarize(std::vector<double> samples);
+
+#endif //STATISTICS_H
@@ -0,0 +1,173 @@
+#include "trace.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "cacheline.h"
+
+#ifdef PI_TRACING
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+/*
+ * Буфер потока на отдельных кэш-линиях: потоки пишут только в свои буферы,
+ * и счетчики записей разных потоков не делят кэш-линию.
+ * */
+struct alignas(CACHE_LINE_SIZE) TraceBuffer {
+    std::unique_ptr<TraceRecord[]> records;
+    // Всего записано (позиция записи - written % TRACE_BUFFER_CAPACITY)
+    uint64_t written = 0;
+};
+
+static std::vector<TraceBuffer> buffers;
+static thread_local TraceBuffer *currentBuffer = nullptr;
+// Буфер главного потока последнего расчета (следует за буферами его потоков)
+static size_t mainBuffer = 0;
+
+/*
+ * Пересчет тактов TSC в микросекунды: пара отметок (TSC, steady_clock)
+ * в начале расчета и при выгрузке.
+ * */
+static uint64_t startTicks;
+static std::chrono::steady_clock::time_point startTime;
+
+uint64_t traceTimestamp() {
+    return __rdtsc();
+}
+
+void traceRecord(TraceEvent event, uint64_t start, uint64_t end, long long argument) {
+    TraceBuffer *buffer = currentBuffer;
+    if (!buffer)
+        return;
+    buffer->records[buffer->written % TRACE_BUFFER_CAPACITY] = {start, end, argument, event};
+    buffer->written++;
+}
+
+bool tracingEnabled() {
+    return true;
+}
+
+void traceReset(int numberOfThreads) {
+    if ((int) buffers.size() < numberOfThreads + 1) {
+        buffers.resize(numberOfThreads + 1);
+        for (TraceBuffer &buffer : buffers) {
+            if (!buffer.records)
+                buffer.records = std::make_unique<TraceRecord[]>(TRACE_BUFFER_CAPACITY);
+        }
+    }
+    for (TraceBuffer &buffer : buffers)
+        buffer.written = 0;
+    // Главный поток пишет в последний буфер текущего расчета
+    mainBuffer = numberOfThreads;
+    currentBuffer = &buffers[mainBuffer];
+    startTicks = traceTimestamp();
+    startTime = std::chrono::steady_clock::now();
+}
+
+void traceAttach(int buffer) {
+    currentBuffer = &buffers[buffer];
+}
+
+static const char *traceEventName(TraceEvent event) {
+    switch (event) {
+        case TraceEvent::Block:
+            return "block";
+        case TraceEvent::Parked:
+            return "parked";
+        case TraceEvent::Steal:
+            return "steal";
+        case TraceEvent::Wait:
+            return "wait";
+        case TraceEvent::Resume:
+            return "resume";
+        case TraceEvent::Progress:
+            return "progress";
+        case TraceEvent::Join:
+            return "join";
+    }
+    return "unknown";
+}
+
+bool writeTrace(const std::string &fileName) {
+    std::ofstream file(fileName);
+    if (!file) {
+        std::cerr << "Could not open " << fileName << std::endl;
+        return false;
+    }
+
+    double elapsedMicroseconds = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - startTime).count();
+    double ticksPerMicrosecond = (traceTimestamp() - startTicks) / elapsedMicroseconds;
+    auto microseconds = [&](uint64_t ticks) {
+        return (double) (int64_t) (ticks - startTicks) / ticksPerMicrosecond;
+    };
+
+    bool json = fileName.size() >= 5 && fileName.compare(fileName.size() - 5, 5, ".json") == 0;
+    if (json)
+        file << "{\"traceEvents\": [";
+    else
+        file << "thread,event,argument,start_us,duration_us" << std::endl;
+
+    bool first = true;
+    uint64_t dropped = 0;
+    for (size_t thread = 0; thread <= mainBuffer; thread++) {
+        const TraceBuffer &buffer = buffers[thread];
+        uint64_t count = std::min<uint64_t>(buffer.written, TRACE_BUFFER_CAPACITY);
+        dropped += buffer.written - count;
+
+        if (json) {
+            file << (first ? "" : ",") << std::endl
+                 << "  {\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 0, \"tid\": " << thread
+                 << ", \"args\": {\"name\": \""
+                 << (thread == mainBuffer ? std::string("main") : "worker " + std::to_string(thread)) << "\"}}";
+            first = false;
+        }
+        for (uint64_t i = buffer.written - count; i < buffer.written; i++) {
+            const TraceRecord &record = buffer.records[i % TRACE_BUFFER_CAPACITY];
+            double start = microseconds(record.start);
+            double duration = (record.end - record.start) / ticksPerMicrosecond;
+            if (json) {
+                file << "," << std::endl
+                     << "  {\"ph\": \"X\", \"name\": \"" << traceEventName(record.event) << "\", \"pid\": 0, \"tid\": "
+                     << thread << ", \"ts\": " << start << ", \"dur\": " << duration
+                     << ", \"args\": {\"argument\": " << record.argument << "}}";
+            } else {
+                file << (thread == mainBuffer ? std::string("main") : std::to_string(thread)) << ','
+                     << traceEventName(record.event) << ',' << record.argument << ','
+                     << start << ',' << duration << std::endl;
+            }
+        }
+    }
+    if (json)
+        file << std::endl << "]}" << std::endl;
+
+    if (dropped)
+        std::cerr << dropped << " oldest trace events were overwritten" << std::endl;
+    return true;
+}
+
+#else
+
+bool tracingEnabled() {
+    return false;
+}
+
+void traceReset(int) {
+}
+
+void traceAttach(int) {
+}
+
+bool writeTrace(const std::string &) {
+    std::cerr << "Tracing is not compiled in, configure with -DENABLE_TRACING=ON" << std::endl;
+    return false;
+}
+
+#endif
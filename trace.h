@@ -0,0 +1,93 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <string>
+
+/*
+ * Трассировка горячего пути.
+ * Каждый поток пишет интервалы (начало, конец в тактах TSC) в свой
+ * кольцевой буфер без синхронизации; после расчета буферы можно
+ * выгрузить в формате Chrome trace (chrome://tracing, Perfetto) или CSV.
+ * Собирается только с -DENABLE_TRACING=ON (макрос PI_TRACING):
+ * без него TRACE_SCOPE и TRACE_THREAD раскрываются в пустые операторы.
+ * */
+
+// Тип интервала
+enum class TraceEvent : uint8_t {
+    // Поток считает блок (argument - первая итерация блока)
+    Block,
+    // Поток приостановлен после сообщения о блоке до resumeWorker (Handshake)
+    Parked,
+    // Попытка захвата блока из чужого дека (argument - номер "жертвы")
+    Steal,
+    // Главный поток ждет сообщения о готовом блоке
+    Wait,
+    // Главный поток возобновляет поток (argument - его номер)
+    Resume,
+    // Главный поток учитывает готовые блоки в прогрессивной оценке
+    Progress,
+    // Главный поток ждет окончания задания
+    Join
+};
+
+struct TraceRecord {
+    uint64_t start;
+    uint64_t end;
+    long long argument;
+    TraceEvent event;
+};
+
+// Число записей в буфере одного потока; при переполнении затираются самые старые
+constexpr size_t TRACE_BUFFER_CAPACITY = 1 << 14;
+
+// Собрана ли программа с трассировкой
+bool tracingEnabled();
+
+/*
+ * Подготовка буферов перед расчетом: numberOfThreads буферов для потоков
+ * и еще один для главного потока. Записи прошлого расчета удаляются.
+ * */
+void traceReset(int numberOfThreads);
+
+// Привязка вызывающего потока к буферу (номер потока или numberOfThreads для главного).
+void traceAttach(int buffer);
+
+// Выгрузка последнего расчета: *.json - Chrome trace, иначе CSV.
+bool writeTrace(const std::string &fileName);
+
+#ifdef PI_TRACING
+
+uint64_t traceTimestamp();
+
+void traceRecord(TraceEvent event, uint64_t start, uint64_t end, long long argument);
+
+// Записывает интервал от создания до разрушения объекта
+class TraceScope {
+public:
+    TraceScope(TraceEvent event, long long argument) : event(event), argument(argument),
+                                                       start(traceTimestamp()) {}
+
+    ~TraceScope() {
+        traceRecord(event, start, traceTimestamp(), argument);
+    }
+
+private:
+    TraceEvent event;
+    long long argument;
+    uint64_t start;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(event, argument) TraceScope TRACE_CONCAT(traceScope, __LINE__)(event, argument)
+#define TRACE_THREAD(buffer) traceAttach(buffer)
+
+#else
+
+#define TRACE_SCOPE(event, argument) ((void) 0)
+#define TRACE_THREAD(buffer) ((void) 0)
+
+#endif
+
+#endif //TRACE_H
@@ -0,0 +1,51 @@
+#include "workstealing.h"
+
+void WorkStealingDeque::reset(long long newCapacity) {
+    capacity = newCapacity > 0 ? newCapacity : 1;
+    buffer = std::make_unique<std::atomic<long long>[]>(capacity);
+    top.store(0, std::memory_order_relaxed);
+    bottom.store(0, std::memory_order_relaxed);
+}
+
+void WorkStealingDeque::push(long long block) {
+    long long b = bottom.load(std::memory_order_relaxed);
+    buffer[b % capacity].store(block, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+bool WorkStealingDeque::pop(long long &block) {
+    long long b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        // Дек пуст - восстанавливаем bottom
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    block = buffer[b % capacity].load(std::memory_order_relaxed);
+    if (t == b) {
+        // Последний блок: соревнуемся с "ворами" за top
+        bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+    return true;
+}
+
+WorkStealingDeque::StealResult WorkStealingDeque::steal(long long &block) {
+    long long t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long b = bottom.load(std::memory_order_acquire);
+
+    if (t >= b)
+        return StealResult::Empty;
+
+    block = buffer[t % capacity].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return StealResult::Lost;
+    return StealResult::Success;
+}
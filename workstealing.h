@@ -0,0 +1,54 @@
+#ifndef WORKSTEALING_H
+#define WORKSTEALING_H
+
+#include <atomic>
+#include <memory>
+
+#include "cacheline.h"
+
+/*
+ * Дек номеров блоков для планировщика с захватом работы (work stealing),
+ * алгоритм Chase-Lev (в варианте для модели памяти C11 из статьи
+ * Lê, Pop, Cohen, Zappa Nardelli "Correct and Efficient Work-Stealing
+ * for Weak Memory Models", 2013).
+ * Владелец кладет и забирает блоки с "низа" дека (push/pop) без
+ * атомарных read-modify-write операций, кроме случая последнего блока;
+ * другие потоки забирают блоки с "верха" (steal) через compare_exchange.
+ * Все блоки кладутся в дек до запуска потоков, поэтому емкость
+ * фиксирована и буфер не растет.
+ * */
+class WorkStealingDeque {
+public:
+    // Результат попытки захвата
+    enum class StealResult {
+        Success,
+        // Дек пуст
+        Empty,
+        // Блок перехватил другой поток (владелец или другой "вор")
+        Lost
+    };
+
+    WorkStealingDeque() = default;
+    WorkStealingDeque(const WorkStealingDeque &) = delete;
+    WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+    // Выделение буфера; вызывается до запуска потоков.
+    void reset(long long capacity);
+
+    // Добавление блока владельцем.
+    void push(long long block);
+
+    // Получение блока владельцем; false, если дек пуст.
+    bool pop(long long &block);
+
+    // Захват блока другим потоком.
+    StealResult steal(long long &block);
+
+private:
+    alignas(CACHE_LINE_SIZE) std::atomic<long long> top{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<long long> bottom{0};
+    std::unique_ptr<std::atomic<long long>[]> buffer;
+    long long capacity = 0;
+};
+
+#endif //WORKSTEALING_H